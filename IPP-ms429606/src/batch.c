@@ -0,0 +1,145 @@
+/** @file
+  Implementacja trybu wsadowego kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "batch.h"
+#include "session.h"
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#define OUT_SUFFIX ".out"       ///< Rozszerzenie pliku z wynikami.
+#define ERR_SUFFIX ".err"       ///< Rozszerzenie pliku z komunikatami o błędach.
+#define FILE_MODE 0644          ///< Prawa dostępu tworzonych plików.
+#define NANOSECONDS 1e9         ///< Liczba nanosekund w sekundzie.
+
+/**
+ * To jest struktura przechowująca stan trybu wsadowego, wspólny dla
+ * wszystkich wątków puli.
+ */
+typedef struct Batch {
+    char **paths;               ///< ścieżki plików do wykonania
+    int count;                  ///< liczba plików
+    atomic_int next;            ///< indeks następnego pliku do pobrania
+    double *seconds;            ///< czasy wykonania plików
+    bool *opened;               ///< czy udało się otworzyć plik i jego wyjścia
+    SessionOptions options;     ///< opcje sesji
+} Batch;
+
+/**
+ * Funkcja zwraca bieżący czas monotoniczny w sekundach.
+ */
+static double Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / NANOSECONDS;
+}
+
+/**
+ * Funkcja tworzy plik wyjściowy o nazwie @p path z dopisanym @p suffix.
+ * @return deskryptor pliku lub -1, jeśli nie udało się go utworzyć
+ */
+static int CreateOutput(const char *path, const char *suffix) {
+    size_t length = strlen(path);
+    char *name = malloc(length + strlen(suffix) + 1);
+    if (name == NULL) exit(1);
+    memcpy(name, path, length);
+    strcpy(name + length, suffix);
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, FILE_MODE);
+    free(name);
+    return fd;
+}
+
+/**
+ * Funkcja wykonuje jeden plik z poleceniami, przekierowując wyjście
+ * bieżącego wątku do jego plików wyjściowych.
+ * @return false, jeśli nie udało się otworzyć któregoś z plików
+ */
+static bool RunScript(const char *path, const SessionOptions *options,
+                      double *seconds) {
+    int in_fd = open(path, O_RDONLY);
+    int out_fd = in_fd < 0 ? -1 : CreateOutput(path, OUT_SUFFIX);
+    int err_fd = out_fd < 0 ? -1 : CreateOutput(path, ERR_SUFFIX);
+    bool opened = (err_fd >= 0);
+    if (opened) {
+        double start = Now();
+        OutputRedirect(out_fd, err_fd);
+        SessionRun(in_fd, false, options);
+        *seconds = Now() - start;
+    }
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+    if (err_fd >= 0) close(err_fd);
+    return opened;
+}
+
+/**
+ * Funkcja wątku puli. Pobiera kolejne pliki, aż wszystkie zostaną
+ * rozdzielone. Każda sesja działa w jednym wątku, bo równoległość
+ * zapewniają już inne wątki puli.
+ */
+static void *Worker(void *arg) {
+    Batch *batch = arg;
+    int i;
+    while ((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        batch->opened[i] = RunScript(batch->paths[i], &batch->options,
+                                     &batch->seconds[i]);
+    }
+    return NULL;
+}
+
+int BatchRun(int count, char *paths[], const SessionOptions *options) {
+    Batch batch = {.paths = paths, .count = count, .options = *options};
+    // Procesory zajmują już wątki puli, więc MULMANY nie tworzy nowych.
+    batch.options.threads = 1;
+    atomic_init(&batch.next, 0);
+    batch.seconds = calloc(count + 1, sizeof(double));
+    batch.opened = calloc(count + 1, sizeof(bool));
+    if (batch.seconds == NULL || batch.opened == NULL) exit(1);
+
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > count) workers = count;
+    if (workers < 1) workers = 1;
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    if (threads == NULL) exit(1);
+
+    double start = Now();
+    for (long i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, Worker, &batch) != 0) exit(1);
+    }
+    for (long i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double wall = Now() - start;
+
+    int status = 0;
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        if (batch.opened[i]) {
+            printf("%s %.3f s\n", paths[i], batch.seconds[i]);
+            total += batch.seconds[i];
+        }
+        else {
+            fprintf(stderr, "%s CANNOT OPEN\n", paths[i]);
+            status = 1;
+        }
+    }
+    printf("BATCH %d files %.3f s wall %.3f s total %ld threads\n",
+           count, wall, total, workers);
+
+    free(threads);
+    free(batch.seconds);
+    free(batch.opened);
+    return status;
+}
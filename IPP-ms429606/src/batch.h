@@ -0,0 +1,28 @@
+/** @file
+  Interfejs trybu wsadowego kalkulatora, w którym jeden proces wykonuje
+  wiele niezależnych plików z poleceniami na puli wątków.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "session.h"
+
+#define BATCH_OPTION "--batch"  ///< Opcja wiersza poleceń włączająca tryb wsadowy.
+
+/**
+ * Funkcja wykonuje @p count plików o ścieżkach @p paths, każdy w osobnej
+ * sesji (z własnym stosem i rejestrami) na jednym z wątków puli. Wyniki
+ * pliku trafiają do pliku o nazwie z dopisanym ".out", a komunikaty
+ * o błędach do pliku z dopisanym ".err". Sesje mają opcje @p options
+ * (zob. session.h). Na koniec wypisuje na standardowe
+ * wyjście czas wykonania każdego pliku i podsumowanie.
+ * @return kod wyjścia procesu: 1, jeśli któregoś pliku nie udało się
+ * otworzyć, a 0 w przeciwnym razie
+ */
+int BatchRun(int count, char *paths[], const SessionOptions *options);
+
+#endif /* __BATCH_H__ */
@@ -0,0 +1,47 @@
+/** @file
+  Stałe znaków i funkcje rozpoznające znaki, wspólne dla parsera
+  wielomianów, kompilatora linii i parsera instrukcji kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __CHARACTERS_H__
+#define __CHARACTERS_H__
+
+#include <stdbool.h>
+
+// Znaki.
+#define MINUS '-'               ///< Stała oznaczająca znak '-'.
+#define ENDL '\n'               ///< Stała oznaczająca znak '\n'.
+#define ASCII_ZERO '0'          ///< Stała oznaczająca znak '0'.
+#define ASCII_NINE '9'          ///< Stała oznaczająca znak '9'.
+
+// Litery.
+#define CAPITAL_A 'A'           ///< Stała oznaczająca literę A.
+#define SMALL_A 'a'             ///< Stała oznaczająca literę a.
+#define CAPITAL_Z 'Z'           ///< Stała oznaczająca literę Z.
+#define SMALL_Z 'z'             ///< Stała oznaczająca literę z.
+
+/**
+ * Funkcja sprawdza, czy znak jest cyfrą.
+ */
+static inline bool IsDigit(char c) {
+    return c >= ASCII_ZERO && c <= ASCII_NINE;
+}
+
+/**
+ * Funkcja sprawdza, czy znak jest literą.
+ */
+static inline bool IsLetter(char c) {
+    return (c >= SMALL_A && c <= SMALL_Z) || (c >= CAPITAL_A && c <= CAPITAL_Z);
+}
+
+/**
+ * Funkcja sprawdza, czy znak kończy linię.
+ */
+static inline bool IsLineEnd(char c) {
+    return c == 0 || c == ENDL;
+}
+
+#endif /* __CHARACTERS_H__ */
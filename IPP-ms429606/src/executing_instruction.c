@@ -5,205 +5,373 @@
   @date 2021
 */
 #include "executing_instruction.h"
+#include "characters.h"
 #include "instructions.h"
-#include <stdio.h>
+#include "output.h"
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <limits.h>
 #include <stdbool.h>
-#include <errno.h>
 
-#define ENDL '\n'               ///< Stała oznaczająca znak '\n'.
-
-#define ASCII_ZERO '0'          ///< Stała oznaczająca znak '0'.
-#define ASCII_NINE '9'          ///< Stała oznaczająca znak '9'.
 #define DECIMAL_BASE 10         ///< Stała oznaczająca bazę systemu dziesiątkowego.
 #define SPACE ' '               ///< Stała oznaczająca znak ' '.
-#define MINUS '-'               ///< Stała oznaczająca znak '#'.
-
-// Instrukcje.
-#define ZERO "ZERO"             ///< Stała oznaczająca polecenie ZERO.
-#define IS_COEFF "IS_COEFF"     ///< Stała oznaczająca polecenie IS_COEFF.
-#define IS_ZERO "IS_ZERO"       ///< Stała oznaczająca polecenie IS_ZERO.
-#define CLONE "CLONE"           ///< Stała oznaczająca polecenie CLONE.
-#define ADD "ADD"               ///< Stała oznaczająca polecenie ADD.
-#define MUL "MUL"               ///< Stała oznaczająca polecenie MUL.
-#define NEG "NEG"               ///< Stała oznaczająca polecenie NEG.
-#define SUB "SUB"               ///< Stała oznaczająca polecenie SUB.
-#define IS_EQ "IS_EQ"           ///< Stała oznaczająca polecenie IS_EQ.
-#define DEG "DEG"               ///< Stała oznaczająca polecenie DEG.
-#define DEG_BY "DEG_BY"         ///< Stała oznaczająca polecenie DEG_BY.
-#define AT "AT"                 ///< Stała oznaczająca polecenie AT.
-#define PRINT "PRINT"           ///< Stała oznaczająca polecenie PRINT.
-#define POP "POP"               ///< Stała oznaczająca polecenie POP.
-#define COMPOSE "COMPOSE"       ///< Stała oznaczająca polecenie COMPOSE.
+#define UNDERSCORE '_'          ///< Stała oznaczająca znak '_'.
+
+// Identyfikatory instrukcji.
+#define ADD_ID 'A'              ///< Stała na identyfikator instrukcji ADD.
+#define SUB_ID 'S'              ///< Stała na identyfikator instrukcji SUB.
+#define MUL_ID 'M'              ///< Stała na identyfikator instrukcji MUL.
 
 /**
- * Stała oznaczająca index, na którym w poleceniu AT powinna wystąpić
- * cyfra lub '-'.
+ * Opis instrukcji: nazwa, rodzaj parametru oraz, dla instrukcji
+ * z parametrem, komunikat o niepoprawnym parametrze.
  */
-#define AT_DIGIT_IDX 3
+typedef struct Instruction {
+    const char *name;           ///< nazwa polecenia
+    ParameterKind param;        ///< rodzaj parametru
+    const char *param_error;    ///< komunikat o błędnym parametrze lub NULL
+} Instruction;
+
 /**
- * Stała oznaczająca index, na którym w poleceniu DEG_BY powinna wystąpić
- * cyfra.
+ * Tablica instrukcji indeksowana identyfikatorami InstructionId.
  */
-#define DEG_BY_DIGIT_IDX 7
+static const Instruction INSTRUCTIONS[] = {
+    [INSTR_ZERO] = {"ZERO", PARAM_NONE, NULL},
+    [INSTR_IS_COEFF] = {"IS_COEFF", PARAM_NONE, NULL},
+    [INSTR_IS_ZERO] = {"IS_ZERO", PARAM_NONE, NULL},
+    [INSTR_CLONE] = {"CLONE", PARAM_NONE, NULL},
+    [INSTR_ADD] = {"ADD", PARAM_NONE, NULL},
+    [INSTR_MUL] = {"MUL", PARAM_NONE, NULL},
+    [INSTR_NEG] = {"NEG", PARAM_NONE, NULL},
+    [INSTR_SUB] = {"SUB", PARAM_NONE, NULL},
+    [INSTR_IS_EQ] = {"IS_EQ", PARAM_NONE, NULL},
+    [INSTR_DEG] = {"DEG", PARAM_NONE, NULL},
+    [INSTR_PRINT] = {"PRINT", PARAM_NONE, NULL},
+    [INSTR_POP] = {"POP", PARAM_NONE, NULL},
+    [INSTR_MULADD] = {"MULADD", PARAM_NONE, NULL},
+    [INSTR_DEG_BY] = {"DEG_BY", PARAM_UNSIGNED, "DEG BY WRONG VARIABLE"},
+    [INSTR_AT] = {"AT", PARAM_SIGNED, "AT WRONG VALUE"},
+    [INSTR_COMPOSE] = {"COMPOSE", PARAM_UNSIGNED, "COMPOSE WRONG PARAMETER"},
+    [INSTR_POW] = {"POW", PARAM_UNSIGNED, "POW WRONG EXPONENT"},
+    [INSTR_SAVE] = {"SAVE", PARAM_TEXT, "SAVE WRONG FILE"},
+    [INSTR_LOAD] = {"LOAD", PARAM_TEXT, "LOAD WRONG FILE"},
+    [INSTR_SWAP] = {"SWAP", PARAM_NONE, NULL},
+    [INSTR_ROT] = {"ROT", PARAM_NONE, NULL},
+    [INSTR_PICK] = {"PICK", PARAM_UNSIGNED, "PICK WRONG PARAMETER"},
+    [INSTR_DROP] = {"DROP", PARAM_UNSIGNED, "DROP WRONG PARAMETER"},
+    [INSTR_DEPTH] = {"DEPTH", PARAM_NONE, NULL},
+    [INSTR_STORE] = {"STORE", PARAM_TEXT, "STORE WRONG NAME"},
+    [INSTR_RECALL] = {"RECALL", PARAM_TEXT, "RECALL WRONG NAME"},
+    [INSTR_FREE] = {"FREE", PARAM_TEXT, "FREE WRONG NAME"},
+    [INSTR_ADD_N] = {"ADD_N", PARAM_UNSIGNED, "ADD N WRONG PARAMETER"},
+    [INSTR_MUL_N] = {"MUL_N", PARAM_UNSIGNED, "MUL N WRONG PARAMETER"},
+    [INSTR_REPEAT] = {"REPEAT", PARAM_UNSIGNED, "REPEAT WRONG COUNT"},
+    [INSTR_END] = {"END", PARAM_NONE, NULL},
+    [INSTR_STATS] = {"STATS", PARAM_NONE, NULL},
+};
+
 /**
- * Stała oznaczająca index, na którym w poleceniu COMPOSE powinna wystąpić
- * cyfra.
+ * Funkcja zwraca @p id, jeśli słowo jest nazwą instrukcji @p id,
+ * a w przeciwnym razie INSTR_UNKNOWN. Długość słowa jest już sprawdzona.
  */
-#define COMPOSE_DIGIT_IDX 8
-
-// Identyfikatory instrukcji.
-#define ADD_ID 'A'              ///< Stała na identyfikator instrukcji ADD.
-#define SUB_ID 'S'              ///< Stała na identyfikator instrukcji SUB.
-#define MUL_ID 'M'              ///< Stała na identyfikator instrukcji MUL.
+static InstructionId Match(const char *word, size_t length, InstructionId id) {
+    if (memcmp(word, INSTRUCTIONS[id].name, length) == 0) return id;
+    else return INSTR_UNKNOWN;
+}
 
 /**
- * Funkcja sprawdza, czy znak jest cyfrą.
+ * Funkcja rozpoznaje instrukcję po długości słowa i jego pierwszych znakach,
+ * po czym potwierdza ją jednym porównaniem z nazwą.
  */
-static bool IsDigit(char c) {
-    if (c >= ASCII_ZERO && c <= ASCII_NINE) return true;
-    else return false;
+static InstructionId FindInstruction(const char *word, size_t length) {
+    switch (length) {
+        case 2:
+            return Match(word, length, INSTR_AT);
+        case 3:
+            switch (word[0]) {
+                case 'A': return Match(word, length, INSTR_ADD);
+                case 'D': return Match(word, length, INSTR_DEG);
+                case 'E': return Match(word, length, INSTR_END);
+                case 'M': return Match(word, length, INSTR_MUL);
+                case 'N': return Match(word, length, INSTR_NEG);
+                case 'R': return Match(word, length, INSTR_ROT);
+                case 'S': return Match(word, length, INSTR_SUB);
+                case 'P':
+                    if (word[2] == 'P') return Match(word, length, INSTR_POP);
+                    else return Match(word, length, INSTR_POW);
+                default: return INSTR_UNKNOWN;
+            }
+        case 4:
+            switch (word[0]) {
+                case 'D': return Match(word, length, INSTR_DROP);
+                case 'F': return Match(word, length, INSTR_FREE);
+                case 'L': return Match(word, length, INSTR_LOAD);
+                case 'P': return Match(word, length, INSTR_PICK);
+                case 'S':
+                    if (word[1] == 'W') return Match(word, length, INSTR_SWAP);
+                    else return Match(word, length, INSTR_SAVE);
+                case 'Z': return Match(word, length, INSTR_ZERO);
+                default: return INSTR_UNKNOWN;
+            }
+        case 5:
+            switch (word[0]) {
+                case 'A': return Match(word, length, INSTR_ADD_N);
+                case 'C': return Match(word, length, INSTR_CLONE);
+                case 'D': return Match(word, length, INSTR_DEPTH);
+                case 'I': return Match(word, length, INSTR_IS_EQ);
+                case 'M': return Match(word, length, INSTR_MUL_N);
+                case 'P': return Match(word, length, INSTR_PRINT);
+                case 'S':
+                    if (word[2] == 'A') return Match(word, length, INSTR_STATS);
+                    else return Match(word, length, INSTR_STORE);
+                default: return INSTR_UNKNOWN;
+            }
+        case 6:
+            switch (word[0]) {
+                case 'D': return Match(word, length, INSTR_DEG_BY);
+                case 'M': return Match(word, length, INSTR_MULADD);
+                case 'R':
+                    if (word[2] == 'P') return Match(word, length, INSTR_REPEAT);
+                    else return Match(word, length, INSTR_RECALL);
+                default: return INSTR_UNKNOWN;
+            }
+        case 7:
+            switch (word[0]) {
+                case 'C': return Match(word, length, INSTR_COMPOSE);
+                case 'I': return Match(word, length, INSTR_IS_ZERO);
+                default: return INSTR_UNKNOWN;
+            }
+        case 8:
+            return Match(word, length, INSTR_IS_COEFF);
+        default:
+            return INSTR_UNKNOWN;
+    }
 }
 
 /**
- * Funkcja sprawdza, czy znak jest cyfrą lub znakiem '-'.
+ * Funkcja wyznacza długość pierwszego słowa linii, czyli liczbę znaków
+ * przed pierwszym białym znakiem.
  */
-static bool IsDigitOrMinus(char c) {
-    return (IsDigit(c) || c == MINUS);
+static size_t WordLength(const char *line, size_t length) {
+    size_t word_length = 0;
+    while (word_length < length && !isspace(line[word_length])) word_length++;
+    return word_length;
 }
 
 /**
- * Funkcja próbuje wywołać funkcję DegBy. Sprawdza, czy parametr idx jest poprawny.
- * Jeżeli tak, wywołuje funkcję, jeżeli nie to wypisuje na
- * standardowe wyjście diagnostyczne: ERROR w DEG BY WRONG VARIABLE\n.
+ * Funkcja wczytuje w miejscu liczbę nieujemną zapisaną w całości w przedziale
+ * [@p begin, @p end). Zwraca false, jeśli przedział zawiera coś poza cyframi,
+ * jest pusty lub liczba przekracza @p max.
  */
-static void AttemptDegBy(Stack **Polynomials, const char *line, int line_number) {
-    if (!IsDigit(line[DEG_BY_DIGIT_IDX]) || line[DEG_BY_DIGIT_IDX - 1] != SPACE) {
-        fprintf(stderr, "ERROR %d DEG BY WRONG VARIABLE\n", line_number);
+static bool ParseUnsigned(const char *begin, const char *end, unsigned long max,
+                          unsigned long *value) {
+    if (begin == end) return false;
+    unsigned long result = 0;
+    for (const char *c = begin; c < end; c++) {
+        if (!IsDigit(*c)) return false;
+        unsigned long digit = *c - ASCII_ZERO;
+        if (result > (max - digit) / DECIMAL_BASE) return false;
+        result = result * DECIMAL_BASE + digit;
     }
-    else {
-        line += DEG_BY_DIGIT_IDX;
-        char *end;
-        errno = 0;
-        unsigned long idx = strtoul(line, &end, DECIMAL_BASE);
-        if (*end != 0) {
-            fprintf(stderr, "ERROR %d DEG BY WRONG VARIABLE\n", line_number);
-        }
-        else {
-            if (idx == ULONG_MAX && errno == ERANGE) {
-                fprintf(stderr, "ERROR %d DEG BY WRONG VARIABLE\n", line_number);
-            }
-            else {
-                DegBy(Polynomials, idx, line_number);
-            }
-        }
+    *value = result;
+    return true;
+}
+
+/**
+ * Funkcja wczytuje w miejscu liczbę ze znakiem zapisaną w całości w przedziale
+ * [@p begin, @p end). Liczba musi mieścić się w przedziale <LONG_MIN, LONG_MAX>.
+ */
+static bool ParseSigned(const char *begin, const char *end, long *value) {
+    bool negative = (begin < end && *begin == MINUS);
+    if (negative) begin++;
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+    unsigned long magnitude;
+    if (!ParseUnsigned(begin, end, limit, &magnitude)) return false;
+    *value = negative ? (long)(0 - magnitude) : (long)magnitude;
+    return true;
+}
+
+/**
+ * Funkcja sprawdza, czy przedział [@p begin, @p end) jest poprawną nazwą
+ * rejestru, czyli niepustym ciągiem liter, cyfr i znaków '_'.
+ */
+static bool IsName(const char *begin, const char *end) {
+    if (begin == end) return false;
+    for (const char *c = begin; c < end; c++) {
+        if (!isalnum((unsigned char)*c) && *c != UNDERSCORE) return false;
     }
+    return true;
 }
 
 /**
- * Funkcja próbuje wywołać funkcję DegBy. Sprawdza, czy parametr x jest poprawny.
- * Jeżeli tak, wywołuje funkcję, jeżeli nie to wypisuje na
- * standardowe wyjście diagnostyczne: ERROR w AT WRONG VARIABLE\n.
+ * Funkcja wczytuje parametr instrukcji z przedziału [@p begin, @p end).
+ * Liczby muszą zajmować cały przedział, a napisy (nazwy plików i rejestrów)
+ * są sprawdzane dopiero przy wykonaniu.
+ * @return false, jeśli parametr nie jest poprawną liczbą
  */
-static void AttemptAt(Stack **Polynomials, const char *line, int line_number) {
-    if (!IsDigitOrMinus(line[AT_DIGIT_IDX]) || line[AT_DIGIT_IDX - 1] != SPACE) {
-        fprintf(stderr, "ERROR %d AT WRONG VALUE\n", line_number);
+static bool ParseParameter(InstructionId id, const char *begin, const char *end,
+                           Parameter *param) {
+    param->number = 0;
+    param->text = begin;
+    param->length = end - begin;
+    long x;
+    switch (INSTRUCTIONS[id].param) {
+        case PARAM_UNSIGNED:
+            return ParseUnsigned(begin, end, ULONG_MAX, &param->number);
+        case PARAM_SIGNED:
+            if (!ParseSigned(begin, end, &x)) return false;
+            param->number = (unsigned long)x;
+            return true;
+        default:
+            return true;
     }
-    else {
-        line += AT_DIGIT_IDX;
-        char *end;
-        errno = 0;
-        poly_coeff_t x = strtol(line, &end, DECIMAL_BASE);
-        if (*end != 0) {
-            fprintf(stderr, "ERROR %d AT WRONG VALUE\n", line_number);
-        }
-        else {
-            if ((x == LONG_MAX || x == LONG_MIN) && errno == ERANGE) {
-                fprintf(stderr, "ERROR %d AT WRONG VALUE\n", line_number);
-            }
-            else {
-                At(Polynomials, x, line_number);
-            }
-        }
+}
+
+/**
+ * Funkcja wykonuje instrukcję z parametrem.
+ * Parametrem poleceń SAVE i LOAD jest nazwa pliku; ten sam komunikat
+ * wypisujemy, gdy nie uda się zapisać lub wczytać pliku. Parametrem poleceń
+ * STORE, RECALL i FREE jest nazwa rejestru; dla RECALL i FREE ten sam
+ * komunikat oznacza też brak rejestru o tej nazwie.
+ * @return false, jeśli parametr jest niepoprawny
+ */
+static bool ExecuteWithParameter(Stack *Polynomials, Registers *Memory,
+                                 InstructionId id, const Parameter *param,
+                                 int line_number) {
+    const char *begin = param->text;
+    const char *end = param->text + param->length;
+    bool is_path = (param->length > 0 && memchr(begin, 0, param->length) == NULL);
+    switch (id) {
+        case INSTR_DEG_BY:
+            DegBy(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_AT:
+            At(Polynomials, (long)param->number, line_number);
+            return true;
+        case INSTR_COMPOSE:
+            Compose(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_POW:
+            if (param->number > INT_MAX) return false;
+            Pow(Polynomials, (poly_exp_t)param->number, line_number);
+            return true;
+        case INSTR_PICK:
+            Pick(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_DROP:
+            Drop(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_ADD_N:
+            AddMany(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_MUL_N:
+            MulMany(Polynomials, param->number, line_number);
+            return true;
+        case INSTR_STORE:
+            if (!IsName(begin, end)) return false;
+            Store(Polynomials, Memory, begin, end - begin, line_number);
+            return true;
+        case INSTR_RECALL:
+            return IsName(begin, end) &&
+                   Recall(Polynomials, Memory, begin, end - begin);
+        case INSTR_FREE:
+            return IsName(begin, end) && RegistersFree(Memory, begin, end - begin);
+        case INSTR_SAVE:
+            return is_path && Save(Polynomials, begin, end - begin);
+        case INSTR_LOAD:
+            return is_path && Load(Polynomials, begin, end - begin);
+        default:
+            return false;
     }
 }
 
 /**
- * Funkcja próbuje wywołać funkcję COMPOSE. Sprawdza, czy parametr count jest poprawny.
- * Jeżeli tak, wywołuje funkcję, jeżeli nie to wypisuje na
- * standardowe wyjście diagnostyczne: ERROR w COMPOSE WRONG PARAMETER\n.
+ * Funkcja wykonuje instrukcję bez parametru.
  */
-static void AttemptCompose(Stack **Polynomials, const char *line, int line_number) {
-    if (!IsDigit(line[COMPOSE_DIGIT_IDX]) || line[COMPOSE_DIGIT_IDX - 1] != SPACE) {
-        fprintf(stderr, "ERROR %d COMPOSE WRONG PARAMETER\n", line_number);
+static void ExecuteWithoutParameter(Stack *Polynomials, InstructionId id,
+                                    int line_number) {
+    switch (id) {
+        case INSTR_ZERO: Zero(Polynomials); break;
+        case INSTR_IS_COEFF: IsCoeff(Polynomials, line_number); break;
+        case INSTR_IS_ZERO: IsZero(Polynomials, line_number); break;
+        case INSTR_CLONE: Clone(Polynomials, line_number); break;
+        case INSTR_ADD: AddSubOrMul(Polynomials, line_number, ADD_ID); break;
+        case INSTR_MUL: AddSubOrMul(Polynomials, line_number, MUL_ID); break;
+        case INSTR_SUB: AddSubOrMul(Polynomials, line_number, SUB_ID); break;
+        case INSTR_NEG: Neg(Polynomials, line_number); break;
+        case INSTR_IS_EQ: IsEq(Polynomials, line_number); break;
+        case INSTR_DEG: Deg(Polynomials, line_number); break;
+        case INSTR_PRINT: Print(Polynomials, line_number); break;
+        case INSTR_POP: PopPoly(Polynomials, line_number); break;
+        case INSTR_MULADD: MulAdd(Polynomials, line_number); break;
+        case INSTR_SWAP: Swap(Polynomials, line_number); break;
+        case INSTR_ROT: Rot(Polynomials, line_number); break;
+        case INSTR_DEPTH: PrintDepth(Polynomials); break;
+        case INSTR_STATS: PrintStats(line_number); break;
+        default: break;
     }
-    else {
-        line += COMPOSE_DIGIT_IDX;
-        char *end;
-        errno = 0;
-        size_t count = strtoul(line, &end, DECIMAL_BASE);
-        if (*end != 0) {
-            fprintf(stderr, "ERROR %d COMPOSE WRONG PARAMETER\n", line_number);
-        }
-        else {
-            if (((count == ULONG_MAX) || count == 0 ) && errno == ERANGE) {
-                fprintf(stderr, "ERROR %d COMPOSE WRONG PARAMETER\n", line_number);;
-            }
-            else {
-                Compose(Polynomials, count, line_number);
-            }
-        }
+}
+
+ParameterKind InstructionParameter(InstructionId id) {
+    return INSTRUCTIONS[id].param;
+}
+
+const char *InstructionName(InstructionId id) {
+    return INSTRUCTIONS[id].name;
+}
+
+void ExecuteCommand(Stack *Polynomials, Registers *Memory, InstructionId id,
+                    const Parameter *param, int line_number) {
+    if (INSTRUCTIONS[id].param == PARAM_NONE) {
+        ExecuteWithoutParameter(Polynomials, id, line_number);
+    }
+    else if (param == NULL ||
+             !ExecuteWithParameter(Polynomials, Memory, id, param, line_number)) {
+        OutputError(line_number, INSTRUCTIONS[id].param_error);
     }
 }
 
-void ExecuteInstruction(Stack **Polynomials, char *instruction,
-                        const char *const_line, int line_number, size_t line_size) {
-    char *line = malloc((line_size + 1) * sizeof(char));
-    if (line == NULL) exit(1);
-    strcpy(line, const_line);
-    if (line[line_size - 1] == ENDL) {
-        line[line_size - 1] = 0;
+InstructionId ParseInstruction(const char *line, size_t line_size,
+                               Parameter *param, bool *correct) {
+    size_t length = line_size;
+    if (length > 0 && line[length - 1] == ENDL) length--;
+    size_t word_length = WordLength(line, length);
+    InstructionId id = FindInstruction(line, word_length);
+    *correct = true;
+
+    if (id == INSTR_UNKNOWN) {
+        return INSTR_UNKNOWN;
+    }
+    else if (INSTRUCTIONS[id].param != PARAM_NONE) {
+        // Parametr musi zaczynać się zaraz po pojedynczej spacji za nazwą
+        // polecenia i ciągnąć się do końca linii.
+        const char *begin = line + word_length + 1;
+        const char *end = line + length;
+        *correct = (line[word_length] == SPACE && begin < end &&
+                    ParseParameter(id, begin, end, param));
+        return id;
+    }
+    else if (word_length == length) {
+        return id;
     }
     else {
-        line_size++;
+        return INSTR_UNKNOWN;
     }
-    if (strlen(instruction) == line_size - 1) {
-        if (strcmp(instruction, ZERO) == 0) Zero(Polynomials);
-        else if (strcmp(instruction, IS_COEFF) == 0) IsCoeff(Polynomials, line_number);
-        else if (strcmp(instruction, IS_ZERO) == 0) IsZero(Polynomials, line_number);
-        else if (strcmp(instruction, CLONE) == 0) Clone(Polynomials, line_number);
-        else if (strcmp(instruction, ADD) == 0) AddSubOrMul(Polynomials, line_number, ADD_ID);
-        else if (strcmp(instruction, MUL) == 0) AddSubOrMul(Polynomials, line_number, MUL_ID);
-        else if (strcmp(instruction, SUB) == 0) AddSubOrMul(Polynomials, line_number, SUB_ID);
-        else if (strcmp(instruction, NEG) == 0) Neg(Polynomials, line_number);
-        else if (strcmp(instruction, IS_EQ) == 0) IsEq(Polynomials, line_number);
-        else if (strcmp(instruction, DEG) == 0) Deg(Polynomials, line_number);
-        else if (strcmp(instruction, PRINT) == 0) Print(Polynomials, line_number);
-        else if (strcmp(instruction, POP) == 0) PopPoly(Polynomials, line_number);
-        else if (strcmp(instruction, DEG_BY) == 0) fprintf(stderr, "ERROR %d DEG BY WRONG VARIABLE\n",
-                                                           line_number);
-        else if (strcmp(instruction, AT) == 0) fprintf(stderr, "ERROR %d AT WRONG VALUE\n",
-                                                       line_number);
-        else if (strcmp(instruction, COMPOSE) == 0) fprintf(stderr, "ERROR %d COMPOSE WRONG PARAMETER\n",
-                                                            line_number);
-        else fprintf(stderr, "ERROR %d WRONG COMMAND\n", line_number);
-        free(line);
+}
+
+const char *InstructionError(const char *line, size_t length) {
+    size_t word_length = WordLength(line, length);
+    InstructionId id = FindInstruction(line, word_length);
+    if (id != INSTR_UNKNOWN && INSTRUCTIONS[id].param != PARAM_NONE &&
+        word_length < length) {
+        return INSTRUCTIONS[id].param_error;
     }
     else {
-        if (strcmp(instruction, DEG_BY) == 0) {
-            AttemptDegBy(Polynomials, line, line_number);
-        }
-        else if (strcmp(instruction, AT) == 0) {
-            AttemptAt(Polynomials, line, line_number);
-        }
-        else if (strcmp(instruction, COMPOSE) == 0) {
-            AttemptCompose(Polynomials, line, line_number);
-        }
-        else {
-            fprintf(stderr, "ERROR %d WRONG COMMAND\n", line_number);
-        }
-        free(line);
+        return "WRONG COMMAND";
     }
 }
+
+const char *InstructionParameterError(InstructionId id) {
+    return INSTRUCTIONS[id].param_error;
+}
@@ -11,14 +11,120 @@
 
 #include "poly.h"
 #include "stack.h"
+#include "registers.h"
 
 /**
- * Funkcja sprawdza, czy pierwsze słowo jest którąś z instrukcji, jeśli tak to
- * ją wykonuje lub w przypadku instrukcji dwuargumentowych próbuje wykonać.
- * Jeżeli napotka problem wypisuje na standardowe wyjście diagonostyczne komunikat
- * z błędem.
+ * Instrukcje kalkulatora. Identyfikatory są zarazem kodami operacji
+ * protokołu binarnego (zob. protocol.h), więc nowe instrukcje dopisujemy
+ * na końcu, przed INSTR_UNKNOWN.
  */
-void ExecuteInstruction(Stack **Polynomials, char *instruction,
-                        const char *const_line, int line_number, size_t line_size);
+typedef enum InstructionId {
+    INSTR_ZERO,         ///< polecenie ZERO
+    INSTR_IS_COEFF,     ///< polecenie IS_COEFF
+    INSTR_IS_ZERO,      ///< polecenie IS_ZERO
+    INSTR_CLONE,        ///< polecenie CLONE
+    INSTR_ADD,          ///< polecenie ADD
+    INSTR_MUL,          ///< polecenie MUL
+    INSTR_NEG,          ///< polecenie NEG
+    INSTR_SUB,          ///< polecenie SUB
+    INSTR_IS_EQ,        ///< polecenie IS_EQ
+    INSTR_DEG,          ///< polecenie DEG
+    INSTR_PRINT,        ///< polecenie PRINT
+    INSTR_POP,          ///< polecenie POP
+    INSTR_MULADD,       ///< polecenie MULADD
+    INSTR_DEG_BY,       ///< polecenie DEG_BY
+    INSTR_AT,           ///< polecenie AT
+    INSTR_COMPOSE,      ///< polecenie COMPOSE
+    INSTR_POW,          ///< polecenie POW
+    INSTR_SAVE,         ///< polecenie SAVE
+    INSTR_LOAD,         ///< polecenie LOAD
+    INSTR_SWAP,         ///< polecenie SWAP
+    INSTR_ROT,          ///< polecenie ROT
+    INSTR_PICK,         ///< polecenie PICK
+    INSTR_DROP,         ///< polecenie DROP
+    INSTR_DEPTH,        ///< polecenie DEPTH
+    INSTR_STORE,        ///< polecenie STORE
+    INSTR_RECALL,       ///< polecenie RECALL
+    INSTR_FREE,         ///< polecenie FREE
+    INSTR_ADD_N,        ///< polecenie ADD_N
+    INSTR_MUL_N,        ///< polecenie MUL_N
+    INSTR_REPEAT,       ///< początek bloku REPEAT (zob. program.h)
+    INSTR_END,          ///< koniec bloku REPEAT
+    INSTR_STATS,        ///< polecenie STATS
+    INSTR_UNKNOWN       ///< nieznane polecenie
+} InstructionId;
+
+/**
+ * Rodzaje parametrów instrukcji.
+ */
+typedef enum ParameterKind {
+    PARAM_NONE,         ///< instrukcja bez parametru
+    PARAM_UNSIGNED,     ///< liczba nieujemna
+    PARAM_SIGNED,       ///< liczba ze znakiem
+    PARAM_TEXT          ///< nazwa pliku lub rejestru
+} ParameterKind;
+
+/**
+ * To jest struktura przechowująca wczytany parametr instrukcji.
+ */
+typedef struct Parameter {
+    /** Parametr liczbowy; liczba ze znakiem jest zapisana w kodzie U2. */
+    unsigned long number;
+    /** Parametr napisowy (bez znaku zerowego na końcu). */
+    const char *text;
+    /** Długość parametru napisowego. */
+    size_t length;
+} Parameter;
+
+/**
+ * Funkcja rozpoznaje polecenie w linii o długości @p line_size, nie wykonując
+ * go. Parametr polecenia wczytuje do @p param; parametr napisowy jest
+ * widokiem na linię.
+ * @param[in] line : linia
+ * @param[in] line_size : długość linii, wliczając kończący ją znak '\n'
+ * @param[out] param : wczytany parametr
+ * @param[out] correct : czy parametr jest poprawny (dla instrukcji z parametrem)
+ * @return identyfikator instrukcji albo INSTR_UNKNOWN, jeśli linia nie jest
+ * poprawnym poleceniem (komunikat WRONG COMMAND)
+ */
+InstructionId ParseInstruction(const char *line, size_t line_size,
+                               Parameter *param, bool *correct);
+
+/**
+ * Funkcja zwraca rodzaj parametru instrukcji @p id.
+ */
+ParameterKind InstructionParameter(InstructionId id);
+
+/**
+ * Funkcja zwraca nazwę instrukcji @p id.
+ */
+const char *InstructionName(InstructionId id);
+
+/**
+ * Funkcja wykonuje instrukcję @p id z już wczytanym parametrem @p param.
+ * Dla instrukcji z parametrem NULL oznacza parametr niepoprawny; wtedy,
+ * tak jak dla parametru spoza dopuszczalnego zakresu, wypisuje komunikat
+ * o błędnym parametrze. Zakładamy, że id jest różne od INSTR_UNKNOWN,
+ * INSTR_REPEAT i INSTR_END, które obsługuje program (zob. program.h).
+ */
+void ExecuteCommand(Stack *Polynomials, Registers *Memory, InstructionId id,
+                    const Parameter *param, int line_number);
+
+/**
+ * Funkcja zwraca komunikat o błędzie dla linii z poleceniem, która zawiera
+ * znak zerowy. Jeśli linia zawiera polecenie z parametrem, a po nim biały
+ * znak, jest to komunikat o błędnym parametrze tego polecenia, a w przeciwnym
+ * razie WRONG COMMAND.
+ * @param[in] line : linia
+ * @param[in] length : długość linii do pierwszego znaku zerowego
+ * @return komunikat o błędzie
+ */
+const char *InstructionError(const char *line, size_t length);
+
+/**
+ * Funkcja zwraca komunikat o niepoprawnym parametrze instrukcji @p id
+ * albo NULL, jeśli instrukcja nie ma parametru.
+ */
+const char *InstructionParameterError(InstructionId id);
 
 #endif /* __EXECUTING_INSTRUCTION__ */
@@ -0,0 +1,327 @@
+/** @file
+  Implementacja leniwych wyrażeń kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#include "expr.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#define INITIAL_SIZE 4          ///< Stała na początkowy rozmiar tablicy.
+
+/**
+ * To jest typ wyliczeniowy rodzajów węzłów wyrażenia.
+ */
+typedef enum ExprKind {
+    EXPR_VALUE,     ///< wielomian, także wyliczona wartość innego węzła
+    EXPR_SUM,       ///< suma składników ze znakami
+    EXPR_PRODUCT    ///< iloczyn dwóch wyrażeń
+} ExprKind;
+
+/**
+ * To jest struktura przechowująca składnik sumy.
+ */
+typedef struct Term {
+    /** Wyrażenie będące składnikiem. */
+    Expr *expr;
+    /** Czy składnik jest odejmowany. */
+    bool negated;
+} Term;
+
+/**
+ * To jest struktura przechowująca węzeł wyrażenia.
+ */
+struct Expr {
+    /** Rodzaj węzła. */
+    ExprKind kind;
+    /** Liczba referencji do węzła. */
+    atomic_size_t refs;
+    /** Głębokość niewyliczonej części wyrażenia, 0 dla wartości. */
+    size_t depth;
+    /** Wartość węzła rodzaju EXPR_VALUE. */
+    Poly value;
+    /** Tablica składników węzła rodzaju EXPR_SUM. */
+    Term *terms;
+    /** Liczba składników. */
+    size_t size;
+    /** Rozmiar tablicy składników. */
+    size_t capacity;
+    /** Czynniki węzła rodzaju EXPR_PRODUCT. */
+    Expr *factors[2];
+};
+
+/**
+ * Funkcja tworzy węzeł podanego rodzaju z jedną referencją.
+ */
+static Expr *NewExpr(ExprKind kind) {
+    Expr *e = malloc(sizeof(Expr));
+    if (e == NULL) exit(1);
+    *e = (Expr) {.kind = kind, .depth = 0, .terms = NULL, .size = 0,
+                 .capacity = 0};
+    atomic_init(&e->refs, 1);
+    return e;
+}
+
+Expr *ExprFromPoly(Poly p) {
+    Expr *e = NewExpr(EXPR_VALUE);
+    e->value = p;
+    return e;
+}
+
+Expr *ExprShare(Expr *e) {
+    atomic_fetch_add_explicit(&e->refs, 1, memory_order_relaxed);
+    return e;
+}
+
+/**
+ * Funkcja sprawdza, czy wywołujący ma jedyną referencję do wyrażenia.
+ * Zwolnienie referencji przez inny wątek jest widoczne razem ze wszystkim,
+ * co ten wątek zrobił wcześniej z wyrażeniem.
+ */
+static bool IsUnique(Expr *e) {
+    return atomic_load_explicit(&e->refs, memory_order_acquire) == 1;
+}
+
+/**
+ * Funkcja sprawdza, czy wyrażenie jest niewyliczoną sumą, do której nikt
+ * poza wywołującym nie ma referencji, więc można ją zmieniać w miejscu.
+ */
+static bool IsOwnedSum(Expr *e) {
+    return e->kind == EXPR_SUM && IsUnique(e);
+}
+
+/**
+ * Funkcja dopisuje składnik na koniec sumy.
+ */
+static void AppendTerm(Expr *sum, Expr *e, bool negated) {
+    if (sum->size == sum->capacity) {
+        sum->capacity = sum->capacity == 0 ? INITIAL_SIZE : 2 * sum->capacity;
+        sum->terms = realloc(sum->terms, sum->capacity * sizeof(Term));
+        if (sum->terms == NULL) exit(1);
+    }
+    sum->terms[sum->size++] = (Term) {.expr = e, .negated = negated};
+    if (sum->depth < e->depth + 1) sum->depth = e->depth + 1;
+}
+
+/**
+ * Funkcja wylicza wyrażenie, którego głębokość osiągnęła EXPR_MAX_DEPTH.
+ * Liczenie i zwalnianie są rekurencyjne, więc ograniczenie głębokości
+ * ogranicza zagłębienie wywołań, np. dla długiego ciągu mnożeń.
+ * @return wyrażenie @p e
+ */
+static Expr *LimitDepth(Expr *e) {
+    if (e->depth >= EXPR_MAX_DEPTH) ExprValue(e);
+    return e;
+}
+
+/**
+ * Funkcja dodaje do sumy wyrażenie @p e. Jeżeli @p e jest sumą, którą można
+ * zmieniać, przenosi do @p sum jej składniki i usuwa jej węzeł.
+ */
+static void AddTerms(Expr *sum, Expr *e) {
+    if (IsOwnedSum(e)) {
+        for (size_t i = 0; i < e->size; i++) {
+            AppendTerm(sum, e->terms[i].expr, e->terms[i].negated);
+        }
+        free(e->terms);
+        free(e);
+    }
+    else {
+        AppendTerm(sum, e, false);
+    }
+}
+
+Expr *ExprAdd(Expr *p, Expr *q) {
+    // Dopisujemy do sumy, którą można zmieniać, więc ciąg dodawań
+    // przenosi każdy składnik tylko raz.
+    if (IsOwnedSum(p)) {
+        AddTerms(p, q);
+        return LimitDepth(p);
+    }
+    else if (IsOwnedSum(q)) {
+        AddTerms(q, p);
+        return LimitDepth(q);
+    }
+    Expr *sum = NewExpr(EXPR_SUM);
+    AppendTerm(sum, p, false);
+    AppendTerm(sum, q, false);
+    return LimitDepth(sum);
+}
+
+Expr *ExprSub(Expr *p, Expr *q) {
+    return ExprAdd(p, ExprNeg(q));
+}
+
+Expr *ExprNeg(Expr *p) {
+    if (IsOwnedSum(p)) {
+        for (size_t i = 0; i < p->size; i++) {
+            p->terms[i].negated = !p->terms[i].negated;
+        }
+        return p;
+    }
+    Expr *sum = NewExpr(EXPR_SUM);
+    AppendTerm(sum, p, true);
+    return LimitDepth(sum);
+}
+
+Expr *ExprMul(Expr *p, Expr *q) {
+    Expr *product = NewExpr(EXPR_PRODUCT);
+    product->factors[0] = p;
+    product->factors[1] = q;
+    product->depth = (p->depth > q->depth ? p->depth : q->depth) + 1;
+    return LimitDepth(product);
+}
+
+/**
+ * To jest struktura przechowująca rosnącą tablicę jednomianów.
+ */
+typedef struct MonoArray {
+    Mono *arr;          ///< tablica jednomianów
+    size_t size;        ///< liczba jednomianów
+    size_t capacity;    ///< rozmiar tablicy
+} MonoArray;
+
+/**
+ * Funkcja zapewnia w tablicy miejsce na @p count kolejnych jednomianów.
+ */
+static void MonoArrayReserve(MonoArray *monos, size_t count) {
+    if (monos->size + count > monos->capacity) {
+        size_t needed = monos->size + count;
+        monos->capacity = needed > 2 * monos->capacity ? needed : 2 * monos->capacity;
+        monos->arr = MonosRealloc(monos->arr, monos->capacity);
+        if (monos->arr == NULL) exit(1);
+    }
+}
+
+/**
+ * Funkcja dopisuje do tablicy jednomiany wielomianu @p p, przejmując go
+ * na własność. Współczynnik traktuje jak jednomian o wykładniku 0.
+ */
+static void AppendPoly(MonoArray *monos, Poly p) {
+    if (PolyIsCoeff(&p)) {
+        MonoArrayReserve(monos, 1);
+        monos->arr[monos->size++] = (Mono) {.p = p, .exp = 0};
+    }
+    else {
+        MonoArrayReserve(monos, p.size);
+        for (size_t i = 0; i < p.size; i++) {
+            monos->arr[monos->size++] = p.arr[i];
+        }
+        MonosFree(p.arr);
+    }
+}
+
+/**
+ * Funkcja dopisuje do tablicy iloczyn będący składnikiem sumy i go zwalnia.
+ * Jak PolyMul mnoży każdy jednomian jednego czynnika przez każdy jednomian
+ * drugiego, ale iloczyny jednomianów dopisuje od razu do tablicy sumy,
+ * więc iloczyn nie jest osobno scalany ani dodawany do reszty sumy.
+ */
+static void AppendProduct(MonoArray *monos, Expr *product, bool negated) {
+    const Poly *p = ExprValue(product->factors[0]);
+    const Poly *q = ExprValue(product->factors[1]);
+    if (PolyIsCoeff(p) || PolyIsCoeff(q)) {
+        Poly r = PolyMul(p, q);
+        if (negated) PolyScale(&r, -1);
+        AppendPoly(monos, r);
+    }
+    else {
+        MonoArrayReserve(monos, p->size * q->size);
+        for (size_t i = 0; i < p->size; i++) {
+            for (size_t j = 0; j < q->size; j++) {
+                Poly r = PolyMul(&p->arr[i].p, &q->arr[j].p);
+                if (negated) PolyScale(&r, -1);
+                monos->arr[monos->size].p = r;
+                monos->arr[monos->size].exp = p->arr[i].exp + q->arr[j].exp;
+                monos->size++;
+            }
+        }
+    }
+    ExprRelease(product);
+}
+
+/**
+ * Funkcja wylicza wartość sumy, zwalniając jej składniki. Wszystkie
+ * składniki sumuje jednym dodawaniem k-argumentowym: ich jednomiany
+ * trafiają do jednej tablicy, z której PolyOwnMonos buduje wynik.
+ * Odejmowane składniki negujemy w miejscu, a iloczyny, do których nikt
+ * inny nie ma referencji, dopisujemy przez AppendProduct.
+ */
+static Poly SumValue(Expr *sum) {
+    MonoArray monos = {.arr = NULL, .size = 0, .capacity = 0};
+    for (size_t i = 0; i < sum->size; i++) {
+        Expr *e = sum->terms[i].expr;
+        if (e->kind == EXPR_PRODUCT && IsUnique(e)) {
+            AppendProduct(&monos, e, sum->terms[i].negated);
+        }
+        else {
+            Poly p = ExprTake(e);
+            if (sum->terms[i].negated) PolyScale(&p, -1);
+            AppendPoly(&monos, p);
+        }
+    }
+    free(sum->terms);
+    return PolyOwnMonos(monos.size, monos.arr);
+}
+
+/**
+ * Funkcja wylicza wartość iloczynu, zwalniając jego czynniki.
+ */
+static Poly ProductValue(Expr *product) {
+    Poly value = PolyMul(ExprValue(product->factors[0]),
+                         ExprValue(product->factors[1]));
+    ExprRelease(product->factors[0]);
+    ExprRelease(product->factors[1]);
+    return value;
+}
+
+const Poly *ExprValue(Expr *e) {
+    if (e->kind == EXPR_SUM) {
+        e->value = SumValue(e);
+        e->kind = EXPR_VALUE;
+        e->depth = 0;
+    }
+    else if (e->kind == EXPR_PRODUCT) {
+        e->value = ProductValue(e);
+        e->kind = EXPR_VALUE;
+        e->depth = 0;
+    }
+    return &e->value;
+}
+
+Poly ExprTake(Expr *e) {
+    ExprValue(e);
+    if (!IsUnique(e)) {
+        // Zwalniamy referencję dopiero po skopiowaniu, bo po jej zwolnieniu
+        // inny wątek może usunąć wyrażenie.
+        Poly copy = PolyClone(&e->value);
+        ExprRelease(e);
+        return copy;
+    }
+    Poly value = e->value;
+    free(e);
+    return value;
+}
+
+void ExprRelease(Expr *e) {
+    if (atomic_fetch_sub_explicit(&e->refs, 1, memory_order_acq_rel) > 1) return;
+    switch (e->kind) {
+        case EXPR_VALUE:
+            PolyDestroy(&e->value);
+            break;
+        case EXPR_SUM:
+            for (size_t i = 0; i < e->size; i++) {
+                ExprRelease(e->terms[i].expr);
+            }
+            free(e->terms);
+            break;
+        case EXPR_PRODUCT:
+            ExprRelease(e->factors[0]);
+            ExprRelease(e->factors[1]);
+            break;
+    }
+    free(e);
+}
@@ -0,0 +1,85 @@
+/** @file
+  Interfejs leniwych wyrażeń kalkulatora. Wyrażenie jest węzłem grafu
+  acyklicznego, którego liśćmi są wielomiany, a węzłami wewnętrznymi
+  sumy i iloczyny. Wartość wyrażenia liczymy dopiero wtedy, gdy jest
+  potrzebna, co pozwala połączyć wiele operacji w jedną. Wyrażenie, którego
+  głębokość osiąga EXPR_MAX_DEPTH, jest wyliczane od razu, więc liczenie
+  i zwalnianie wyrażeń nie przepełnia stosu wywołań.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __EXPR_H__
+#define __EXPR_H__
+
+#include "poly.h"
+
+#define EXPR_MAX_DEPTH 1000     ///< Największa głębokość niewyliczonego wyrażenia.
+
+/**
+ * To jest typ wyrażenia. Jego budowa jest ukryta w expr.c. Wyrażenie może
+ * mieć wielu właścicieli (np. po CLONE), każdy z nich posiada jedną
+ * referencję. Funkcje przyjmujące wyrażenie przejmują referencję wywołującego.
+ * Liczba referencji jest zmieniana atomowo, więc referencję do wyliczonego
+ * wyrażenia można przekazać innemu wątkowi, który tylko czyta jego wartość
+ * (zob. OutputExpr w output.h).
+ */
+typedef struct Expr Expr;
+
+/**
+ * Funkcja tworzy wyrażenie o wartości @p p, przejmując wielomian na własność.
+ */
+Expr *ExprFromPoly(Poly p);
+
+/**
+ * Funkcja zwraca nową referencję do wyrażenia @p e, które od tej pory jest
+ * współdzielone. Wartość współdzielonego wyrażenia liczymy tylko raz.
+ */
+Expr *ExprShare(Expr *e);
+
+/**
+ * Funkcja tworzy wyrażenie @p p + @p q. Sumy, które nie są współdzielone,
+ * są spłaszczane, więc ciąg dodawań daje jedną sumę wielu składników.
+ */
+Expr *ExprAdd(Expr *p, Expr *q);
+
+/**
+ * Funkcja tworzy wyrażenie @p p - @p q. Odejmowanie to dodawanie składników
+ * @p q z przeciwnym znakiem, bez osobnego negowania.
+ */
+Expr *ExprSub(Expr *p, Expr *q);
+
+/**
+ * Funkcja tworzy wyrażenie -@p p. Negacja zmienia tylko znaki składników
+ * sumy, a wielomiany negujemy dopiero przy liczeniu wartości.
+ */
+Expr *ExprNeg(Expr *p);
+
+/**
+ * Funkcja tworzy wyrażenie @p p * @p q. Iloczyn będący składnikiem sumy
+ * jest do niej dodawany w miejscu, bez tworzenia iloczynu osobno.
+ */
+Expr *ExprMul(Expr *p, Expr *q);
+
+/**
+ * Funkcja wylicza wartość wyrażenia, jeśli nie była jeszcze wyliczona,
+ * i zapamiętuje ją w wyrażeniu. Referencja wywołującego zostaje.
+ * @return wskaźnik do wartości, ważny dopóki wyrażenie istnieje
+ */
+const Poly *ExprValue(Expr *e);
+
+/**
+ * Funkcja wylicza wartość wyrażenia i zwalnia referencję wywołującego.
+ * Wartość współdzieloną z innymi właścicielami kopiuje.
+ * @return wielomian na własność wywołującego
+ */
+Poly ExprTake(Expr *e);
+
+/**
+ * Funkcja zwalnia referencję do wyrażenia, usuwając je z pamięci,
+ * jeżeli była to ostatnia referencja. Wartość nie jest liczona.
+ */
+void ExprRelease(Expr *e);
+
+#endif /* __EXPR_H__ */
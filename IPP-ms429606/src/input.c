@@ -0,0 +1,140 @@
+/** @file
+  Implementacja warstwy wejścia kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "input.h"
+#include "characters.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INPUT_BUFFER_SIZE (1 << 20)     ///< Początkowy rozmiar bufora wejścia.
+
+void InputOpen(Input *in, int fd) {
+    *in = (Input) {.fd = fd, .data = NULL, .size = 0, .capacity = 0, .pos = 0,
+                   .mapped = false, .eof = false, .tail = NULL};
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            in->data = data;
+            in->size = st.st_size;
+            in->mapped = true;
+            in->eof = true;
+            return;
+        }
+    }
+
+    // Zostawiamy jeden bajt na zero kończące ostatnią linię.
+    in->capacity = INPUT_BUFFER_SIZE;
+    in->data = malloc(in->capacity + 1);
+    if (in->data == NULL) exit(1);
+}
+
+/**
+ * Funkcja dopełnia bufor danymi z wejścia. Nieprzeczytaną część bufora
+ * przesuwa na początek, a jeśli bufor jest już pełny, podwaja go.
+ */
+static void InputFill(Input *in) {
+    if (in->pos > 0) {
+        memmove(in->data, in->data + in->pos, in->size - in->pos);
+        in->size -= in->pos;
+        in->pos = 0;
+    }
+    if (in->size == in->capacity) {
+        in->capacity *= 2;
+        in->data = realloc(in->data, in->capacity + 1);
+        if (in->data == NULL) exit(1);
+    }
+
+    ssize_t count;
+    do {
+        count = read(in->fd, in->data + in->size, in->capacity - in->size);
+    } while (count < 0 && errno == EINTR);
+
+    if (count <= 0) in->eof = true;
+    else in->size += count;
+}
+
+bool InputNextLine(Input *in, const char **line, size_t *size) {
+    char *end = NULL;
+    while (true) {
+        end = memchr(in->data + in->pos, ENDL, in->size - in->pos);
+        if (end != NULL || in->eof) break;
+        InputFill(in);
+    }
+
+    if (end != NULL) {
+        *line = in->data + in->pos;
+        *size = end + 1 - *line;
+        in->pos += *size;
+        return true;
+    }
+    else if (in->pos == in->size) {
+        return false;
+    }
+
+    // Ostatnia linia nie kończy się znakiem '\n', więc dopisujemy za nią zero.
+    // Za odwzorowanym plikiem nie wolno pisać, dlatego ją kopiujemy.
+    *size = in->size - in->pos;
+    if (in->mapped) {
+        in->tail = malloc(*size + 1);
+        if (in->tail == NULL) exit(1);
+        memcpy(in->tail, in->data + in->pos, *size);
+        in->tail[*size] = 0;
+        *line = in->tail;
+    }
+    else {
+        in->data[in->size] = 0;
+        *line = in->data + in->pos;
+    }
+    in->pos = in->size;
+    return true;
+}
+
+bool InputRead(Input *in, size_t size, const char **data) {
+    while (in->size - in->pos < size && !in->eof) InputFill(in);
+    if (in->size - in->pos < size) return false;
+    *data = in->data + in->pos;
+    in->pos += size;
+    return true;
+}
+
+bool InputNextChunk(Input *in, const char **data, size_t *size) {
+    while (in->pos == in->size && !in->eof) InputFill(in);
+    if (in->pos == in->size) return false;
+    *data = in->data + in->pos;
+    *size = in->size - in->pos;
+    in->pos = in->size;
+    return true;
+}
+
+bool InputPeek(Input *in, char *c) {
+    while (in->pos == in->size && !in->eof) InputFill(in);
+    if (in->pos == in->size) return false;
+    *c = in->data[in->pos];
+    return true;
+}
+
+bool InputAvailable(const Input *in, size_t size) {
+    return in->eof || in->size - in->pos >= size;
+}
+
+bool InputHasLine(const Input *in) {
+    return in->eof || memchr(in->data + in->pos, ENDL, in->size - in->pos) != NULL;
+}
+
+void InputClose(Input *in) {
+    if (in->mapped) munmap(in->data, in->size);
+    else free(in->data);
+    free(in->tail);
+}
@@ -0,0 +1,93 @@
+/** @file
+  Interfejs warstwy wejścia kalkulatora. Zwykłe pliki są odwzorowywane
+  w pamięci, a pozostałe wejścia (np. potoki) czytane do jednego,
+  wielokrotnie używanego bufora. Linie są zwracane jako widoki na te dane,
+  bez kopiowania.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * To jest struktura przechowująca stan wejścia.
+ */
+typedef struct Input {
+    /** Deskryptor czytanego pliku. */
+    int fd;
+    /** Odwzorowany plik albo bufor z wczytanymi danymi. */
+    char *data;
+    /** Liczba poprawnych bajtów w @p data. */
+    size_t size;
+    /** Rozmiar bufora (tylko gdy plik nie jest odwzorowany). */
+    size_t capacity;
+    /** Pozycja początku następnej linii. */
+    size_t pos;
+    /** Czy plik jest odwzorowany w pamięci. */
+    bool mapped;
+    /** Czy przeczytaliśmy już cały plik. */
+    bool eof;
+    /** Kopia ostatniej linii odwzorowanego pliku, jeśli nie kończy jej '\n'. */
+    char *tail;
+} Input;
+
+/**
+ * Funkcja przygotowuje wejście do czytania z deskryptora @p fd.
+ * Jeśli deskryptor wskazuje zwykły plik, odwzorowuje go w pamięci.
+ */
+void InputOpen(Input *in, int fd);
+
+/**
+ * Funkcja zwraca widok na kolejną linię wejścia. Linia zaczyna się
+ * w @p line i ma @p size bajtów, wliczając kończący ją znak '\n'.
+ * Jeśli ostatnia linia wejścia nie kończy się znakiem '\n', zaraz za nią
+ * znajduje się znak 0. Widok jest ważny do następnego wywołania funkcji.
+ * @return false, jeśli wejście się skończyło
+ */
+bool InputNextLine(Input *in, const char **line, size_t *size);
+
+/**
+ * Funkcja zwraca widok na kolejne @p size bajtów wejścia, czekając na nie
+ * w razie potrzeby. Widok jest ważny do następnego odczytu.
+ * @return false, jeśli wejście skończyło się wcześniej
+ */
+bool InputRead(Input *in, size_t size, const char **data);
+
+/**
+ * Funkcja zwraca widok na wszystkie bajty wejścia, które są już wczytane,
+ * a jeśli takich nie ma, czeka na kolejną porcję. Widok jest ważny do
+ * następnego odczytu.
+ * @return false, jeśli wejście się skończyło
+ */
+bool InputNextChunk(Input *in, const char **data, size_t *size);
+
+/**
+ * Funkcja podgląda następny bajt wejścia bez zdejmowania go, czekając na
+ * niego w razie potrzeby.
+ * @return false, jeśli wejście się skończyło
+ */
+bool InputPeek(Input *in, char *c);
+
+/**
+ * Funkcja sprawdza, czy InputRead zwróci @p size bajtów (albo zgłosi koniec
+ * wejścia) bez czekania na dane.
+ */
+bool InputAvailable(const Input *in, size_t size);
+
+/**
+ * Funkcja sprawdza, czy InputNextLine zwróci linię bez czekania na dane,
+ * czyli czy w buforze jest cała linia albo wejście już się skończyło.
+ */
+bool InputHasLine(const Input *in);
+
+/**
+ * Funkcja zwalnia zasoby wejścia.
+ */
+void InputClose(Input *in);
+
+#endif /* __INPUT_H__ */
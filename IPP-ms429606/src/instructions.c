@@ -5,12 +5,21 @@
   @author Mikołaj Szkaradek
   @date 2021
 */
+#define _GNU_SOURCE     ///< GNU_SOURCE.
 
 #include "poly.h"
 #include "stack.h"
+#include "registers.h"
 #include "instructions.h"
+#include "output.h"
+#include "stats.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Identyfikatory instrukcji.
 #define ADD_ID 'A'              ///< Stała na identyfikator instrukcji ADD.
@@ -19,203 +28,381 @@
 
 #define INITIAL_SIZE 4          ///< Stała na początkowy rozmiar tablicy.
 
-void Zero(Stack **Polynomials) {
+/// Największa liczba wątków PolyMulMany w bieżącym wątku (zob. SetMulThreads).
+static _Thread_local size_t mul_threads = 1;
+
+/**
+ * Funkcja sprawdza, czy na stosie jest co najmniej @p count wielomianów.
+ * Jeżeli nie, to wypisuje na standardowe wyjście diagnostyczne:
+ * ERROR w STACK UNDERFLOW\n.
+ */
+static bool HasOperands(Stack *Polynomials, size_t count, int line_number) {
+    if (Depth(Polynomials) < count) {
+        OutputError(line_number, "STACK UNDERFLOW");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Funkcja usuwa z wierzchołka stosu @p count argumentów instrukcji
+ * i wstawia na ich miejsce wynik.
+ */
+static void ReplaceOperands(Stack *Polynomials, size_t count, Poly result) {
+    Discard(Polynomials, count);
+    Push(Polynomials, result);
+}
+
+void Zero(Stack *Polynomials) {
     Push(Polynomials, PolyZero());
 }
 
-void IsCoeff(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Top(*Polynomials);
-        if (PolyIsCoeff(&p)) {
-            printf("1\n");
-        }
-        else {
-            printf("0\n");
-        }
+void IsCoeff(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        if (PolyIsCoeff(PeekValue(Polynomials, 0))) OutputNumber(1);
+        else OutputNumber(0);
     }
-    else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+}
+
+void IsZero(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        if (PolyIsZero(PeekValue(Polynomials, 0))) OutputNumber(1);
+        else OutputNumber(0);
     }
 }
 
-void IsZero(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Top(*Polynomials);
-        if (PolyIsZero(&p)) printf("1\n");
-        else printf("0\n");
+void Clone(Stack *Polynomials, int line_number) {
+    if (!HasOperands(Polynomials, 1, line_number)) return;
+    if (Polynomials->lazy) {
+        PushExpr(Polynomials, ExprShare(TopExpr(Polynomials)));
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        Push(Polynomials, PolyClone(PeekValue(Polynomials, 0)));
     }
 }
 
-void Clone(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly top = Top(*Polynomials);
-        Poly p = PolyClone(&top);
-        Push(Polynomials, p);
+/**
+ * Funkcja zastępuje dwa wyrażenia z wierzchu leniwego stosu wyrażeniem
+ * będącym ich sumą/iloczynem/różnicą, bez liczenia wartości.
+ */
+static void LazyAddSubOrMul(Stack *Polynomials, char ID) {
+    Expr *p = PopExpr(Polynomials);
+    Expr *q = PopExpr(Polynomials);
+    if (ID == ADD_ID) PushExpr(Polynomials, ExprAdd(p, q));
+    else if (ID == SUB_ID) PushExpr(Polynomials, ExprSub(p, q));
+    else PushExpr(Polynomials, ExprMul(p, q));
+}
+
+void AddSubOrMul(Stack *Polynomials, int line_number, char ID) {
+    if (!HasOperands(Polynomials, 2, line_number)) return;
+    if (Polynomials->lazy) {
+        LazyAddSubOrMul(Polynomials, ID);
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
-    }
-}
-
-void AddSubOrMul(Stack **Polynomials, int line_number, char ID) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Pop(Polynomials);
-        if (!Empty(*Polynomials)) {
-            Poly q = Pop(Polynomials);
-            Poly result;
-            if (ID == ADD_ID) result = PolyAdd(&p, &q);
-            else if (ID == SUB_ID) result = PolySub(&p,&q);
-            else result = PolyMul(&p, &q);
-            Push(Polynomials, result);
-            PolyDestroy(&p);
-            PolyDestroy(&q);
-        }
-        else {
-            Push(Polynomials, p);
-            fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        const Poly *p = PeekValue(Polynomials, 0);
+        const Poly *q = PeekValue(Polynomials, 1);
+        Poly result;
+        if (ID == ADD_ID) result = PolyAdd(p, q);
+        else if (ID == SUB_ID) result = PolySub(p, q);
+        else result = PolyMul(p, q);
+        ReplaceOperands(Polynomials, 2, result);
+    }
+}
+
+void AddMany(Stack *Polynomials, size_t count, int line_number) {
+    if (!HasOperands(Polynomials, count, line_number)) return;
+    if (Polynomials->lazy) {
+        Expr *sum = ExprFromPoly(PolyZero());
+        for (size_t i = 0; i < count; i++) {
+            sum = ExprAdd(sum, PopExpr(Polynomials));
         }
+        PushExpr(Polynomials, sum);
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        // Sumowane wielomiany po wyliczeniu tworzą tablicę, jak w Compose.
+        const Poly *operands = count > 0 ? Force(Polynomials, count) : NULL;
+        ReplaceOperands(Polynomials, count, PolyAddMany(count, operands));
     }
 }
 
-void Neg(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Pop(Polynomials);
-        Poly p_neg = PolyNeg(&p);
-        Push(Polynomials, p_neg);
-        PolyDestroy(&p);
+void SetMulThreads(size_t threads) {
+    mul_threads = threads;
+}
+
+void MulMany(Stack *Polynomials, size_t count, int line_number) {
+    if (!HasOperands(Polynomials, count, line_number)) return;
+    // Także na leniwym stosie mnożymy od razu, bo PolyMulMany sam wybiera
+    // kolejność mnożenia na podstawie wyliczonych czynników.
+    const Poly *operands = count > 0 ? Force(Polynomials, count) : NULL;
+    ReplaceOperands(Polynomials, count, PolyMulMany(count, operands, mul_threads));
+}
+
+void Neg(Stack *Polynomials, int line_number) {
+    if (!HasOperands(Polynomials, 1, line_number)) return;
+    if (Polynomials->lazy) {
+        PushExpr(Polynomials, ExprNeg(PopExpr(Polynomials)));
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        PolyScale(Top(Polynomials), -1);
     }
 }
 
-void IsEq(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Pop(Polynomials);
-        if (!Empty(*Polynomials)) {
-            Poly q = Top(*Polynomials);
-            if (PolyIsEq(&p, &q)) printf("1\n");
-            else printf("0\n");
-        }
-        else {
-            fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+void IsEq(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 2, line_number)) {
+        if (PolyIsEq(PeekValue(Polynomials, 0), PeekValue(Polynomials, 1))) {
+            OutputNumber(1);
         }
-        Push(Polynomials, p);
+        else OutputNumber(0);
+    }
+}
+
+void Deg(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        OutputNumber(PolyDeg(PeekValue(Polynomials, 0)));
+    }
+}
+
+void PopPoly(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        Discard(Polynomials, 1);
+    }
+}
+
+void Print(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        // Wątkowi wyjścia wielomian, który nie jest współczynnikiem,
+        // przekazujemy jako współdzieloną referencję, żeby nie wymagał kopii.
+        const Poly *p = PeekValue(Polynomials, 0);
+        if (PolyIsCoeff(p) || !OutputThreaded()) OutputPoly(p);
+        else OutputExpr(ExprShare(TopExpr(Polynomials)));
+    }
+}
+
+void DegBy(Stack *Polynomials, unsigned long idx, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        OutputNumber(PolyDegBy(PeekValue(Polynomials, 0), idx));
+    }
+}
+
+void At(Stack *Polynomials, long x, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        ReplaceOperands(Polynomials, 1, PolyAt(PeekValue(Polynomials, 0), x));
+    }
+}
+
+void Compose(Stack *Polynomials, size_t count, int line_number) {
+    // Porównujemy count z głębokością stosu zamiast count + 1, żeby uniknąć
+    // przepełnienia dla count równego SIZE_MAX.
+    if (count >= Depth(Polynomials)) {
+        OutputError(line_number, "STACK UNDERFLOW");
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        // Podstawiane wielomiany leżą pod wielomianem głównym, ten pod
+        // zmienną x_0 najgłębiej, więc po wyliczeniu tworzą gotową tablicę q.
+        const Poly *compose_elems = Force(Polynomials, count + 1);
+        const Poly *main_poly = &compose_elems[count];
+        Poly composed_poly = PolyCompose(main_poly, count, compose_elems);
+        ReplaceOperands(Polynomials, count + 1, composed_poly);
     }
 }
 
-void Deg(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Top(*Polynomials);
-        poly_exp_t deg = PolyDeg(&p);
-        printf("%d\n", deg);
+void Pow(Stack *Polynomials, poly_exp_t exp, int line_number) {
+    if (!HasOperands(Polynomials, 1, line_number)) return;
+    const Poly *p = PeekValue(Polynomials, 0);
+    if (!PolyPowFits(p, exp)) {
+        OutputError(line_number, "POW WRONG EXPONENT");
+        return;
+    }
+    ReplaceOperands(Polynomials, 1, PolyPow(p, exp));
+}
+
+void MulAdd(Stack *Polynomials, int line_number) {
+    if (!HasOperands(Polynomials, 3, line_number)) return;
+    if (Polynomials->lazy) {
+        Expr *p = PopExpr(Polynomials);
+        Expr *q = PopExpr(Polynomials);
+        Expr *r = PopExpr(Polynomials);
+        PushExpr(Polynomials, ExprAdd(r, ExprMul(p, q)));
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        // Dodajemy iloczyn w miejscu do trzeciego wielomianu, który po
+        // zdjęciu dwóch pierwszych zostaje na wierzchołku.
+        PolyFma(Peek(Polynomials, 2), PeekValue(Polynomials, 0),
+                PeekValue(Polynomials, 1));
+        Discard(Polynomials, 2);
+    }
+}
+
+void Swap(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 2, line_number)) {
+        Roll(Polynomials, 1);
     }
 }
 
-void PopPoly(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Pop(Polynomials);
-        PolyDestroy(&p);
+void Rot(Stack *Polynomials, int line_number) {
+    if (HasOperands(Polynomials, 3, line_number)) {
+        Roll(Polynomials, 2);
+    }
+}
+
+void Pick(Stack *Polynomials, size_t k, int line_number) {
+    // Jak w Compose porównujemy k z głębokością stosu, żeby uniknąć
+    // przepełnienia dla k równego SIZE_MAX.
+    if (k >= Depth(Polynomials)) {
+        OutputError(line_number, "STACK UNDERFLOW");
+    }
+    else if (Polynomials->lazy) {
+        PushExpr(Polynomials, ExprShare(PeekExpr(Polynomials, k)));
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        Push(Polynomials, PolyClone(PeekValue(Polynomials, k)));
     }
 }
 
-void Print(Stack **Polynomials, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Top(*Polynomials);
-        PolyPrint(&p);
-        printf("\n");
+void Drop(Stack *Polynomials, size_t count, int line_number) {
+    if (HasOperands(Polynomials, count, line_number)) {
+        Discard(Polynomials, count);
+    }
+}
+
+void ClonePop(Stack *Polynomials, int clone_line, int pop_line) {
+    if (Empty(Polynomials)) {
+        OutputError(clone_line, "STACK UNDERFLOW");
+        OutputError(pop_line, "STACK UNDERFLOW");
+    }
+}
+
+void NegAdd(Stack *Polynomials, int neg_line, int add_line) {
+    if (Polynomials->lazy || Depth(Polynomials) < 2) {
+        Neg(Polynomials, neg_line);
+        AddSubOrMul(Polynomials, add_line, ADD_ID);
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        Poly difference = PolySub(PeekValue(Polynomials, 1), PeekValue(Polynomials, 0));
+        ReplaceOperands(Polynomials, 2, difference);
     }
 }
 
-void DegBy(Stack **Polynomials, unsigned long idx, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Top(*Polynomials);
-        poly_exp_t deg = PolyDegBy(&p, idx);
-        printf("%d\n", deg);
+void CloneMul(Stack *Polynomials, int clone_line, int mul_line) {
+    if (Polynomials->lazy || Empty(Polynomials)) {
+        Clone(Polynomials, clone_line);
+        AddSubOrMul(Polynomials, mul_line, MUL_ID);
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        ReplaceOperands(Polynomials, 1, PolySquare(PeekValue(Polynomials, 0)));
     }
 }
 
-void At(Stack **Polynomials, long x, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly p = Pop(Polynomials);
-        Poly at = PolyAt(&p, x);
-        PolyDestroy(&p);
-        Push(Polynomials, at);
+void CloneAt(Stack *Polynomials, long x, int clone_line, int at_line) {
+    if (Polynomials->lazy || Empty(Polynomials)) {
+        Clone(Polynomials, clone_line);
+        At(Polynomials, x, at_line);
     }
     else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+        Push(Polynomials, PolyAt(PeekValue(Polynomials, 0), x));
     }
 }
 
-void Compose(Stack **Polynomials, size_t count, int line_number) {
-    if (!Empty(*Polynomials)) {
-        Poly main_poly = Pop(Polynomials);
+void PrintDepth(Stack *Polynomials) {
+    OutputNumber((long)Depth(Polynomials));
+}
 
-        size_t size = INITIAL_SIZE;
-        Poly *compose_elems_temp = malloc(size * sizeof(Poly));
-        if (compose_elems_temp == NULL) exit(1);
+void PrintStats(int line_number) {
+    Stats *stats = StatsCurrent().stats;
+    if (stats == NULL) OutputError(line_number, "STATS DISABLED");
+    else OutputReport(line_number, StatsFormat(stats));
+}
 
-        size_t popped_polys = 0;
-        size_t resizer = 0;
-        for (size_t i = 0; i < count; i++) {
-            if (!Empty(*Polynomials)) {
-                Poly p = Pop(Polynomials);
-                compose_elems_temp[i] = p;
-                popped_polys++;
-                resizer++;
-                if (resizer == size) {
-                    size *= 2;
-                    resizer = 0;
-                    compose_elems_temp = realloc(compose_elems_temp, size * sizeof(Poly));
-                    if (compose_elems_temp == NULL) exit(1);
-                }
-            }
-            else {
-                for (size_t i = popped_polys; i > 0; i--) {
-                    Push(Polynomials, compose_elems_temp[i - 1]);
-                }
-                Push(Polynomials, main_poly);
-                free(compose_elems_temp);
-                fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
-                return;
-            }
-        }
-        Poly *compose_elems = malloc(count *sizeof(Poly));
-        if (compose_elems == NULL) exit(1);
-        for (size_t i = 0; i < count; i++) {
-            compose_elems[i] = compose_elems_temp[count - i - 1];
+void Store(Stack *Polynomials, Registers *Memory, const char *name,
+           size_t name_length, int line_number) {
+    if (HasOperands(Polynomials, 1, line_number)) {
+        RegistersStore(Memory, name, name_length, PopExpr(Polynomials));
+    }
+}
+
+bool Recall(Stack *Polynomials, const Registers *Memory, const char *name,
+            size_t name_length) {
+    Expr *e = RegistersFind(Memory, name, name_length);
+    if (e == NULL) return false;
+    PushExpr(Polynomials, ExprShare(e));
+    return true;
+}
+
+/**
+ * Funkcja tworzy zakończoną zerem kopię nazwy pliku z linii.
+ */
+static char *PathFromLine(const char *path, size_t path_length) {
+    char *name = malloc(path_length + 1);
+    if (name == NULL) exit(1);
+    memcpy(name, path, path_length);
+    name[path_length] = 0;
+    return name;
+}
+
+bool Save(Stack *Polynomials, const char *path, size_t path_length) {
+    PolyBuffer buffer = {.data = NULL, .size = 0, .capacity = 0};
+    const Poly *polys = Empty(Polynomials) ? NULL : Force(Polynomials, Depth(Polynomials));
+    for (size_t i = 0; i < Depth(Polynomials); i++) {
+        PolySerialize(&polys[i], &buffer);
+    }
+
+    char *name = PathFromLine(path, path_length);
+    FILE *file = fopen(name, "wb");
+    free(name);
+    bool correct = (file != NULL);
+    if (correct) {
+        correct = fwrite(buffer.data, 1, buffer.size, file) == buffer.size;
+        correct &= (fclose(file) == 0);
+    }
+    free(buffer.data);
+    return correct;
+}
+
+bool Load(Stack *Polynomials, const char *path, size_t path_length) {
+    char *name = PathFromLine(path, path_length);
+    int fd = open(name, O_RDONLY);
+    free(name);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    size_t capacity = INITIAL_SIZE;
+    size_t count = 0;
+    Poly *polys = malloc(capacity * sizeof(Poly));
+    if (polys == NULL) exit(1);
+    size_t pos = 0;
+    bool correct = true;
+    while (correct && pos < size) {
+        if (count == capacity) {
+            capacity *= 2;
+            polys = realloc(polys, capacity * sizeof(Poly));
+            if (polys == NULL) exit(1);
         }
-        free(compose_elems_temp);
-        Poly composed_poly = PolyCompose(&main_poly, count, compose_elems);
-        PolyDestroy(&main_poly);
-        for (size_t i = 0; i < count; i++) {
-            PolyDestroy(&compose_elems[i]);
+        size_t record_size = PolyDeserialize(data + pos, size - pos, &polys[count]);
+        correct = (record_size > 0);
+        if (correct) {
+            pos += record_size;
+            count++;
         }
-        free(compose_elems);
-        Push(Polynomials, composed_poly);
     }
-    else {
-        fprintf(stderr, "ERROR %d STACK UNDERFLOW\n", line_number);
+    munmap((void *)data, size);
+
+    for (size_t i = 0; i < count; i++) {
+        if (correct) Push(Polynomials, polys[i]);
+        else PolyDestroy(&polys[i]);
     }
+    free(polys);
+    return correct;
 }
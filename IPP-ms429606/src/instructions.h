@@ -12,44 +12,72 @@
 /**
  * Funkcja wstawia na wierzchołek stosu wielomian tożsamościowo równy 0.
  */
-void Zero(Stack **Polynomials);
+void Zero(Stack *Polynomials);
 
 /**
  * Funkcja sprawdza, czy wielomian na wierzchołku stosu jest współczynnikiem.
  * Wypisuje na standardowe wyjście 0 lub 1. Jeżeli stos jest pusty to wypisuje
  * na standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
  */
-void IsCoeff(Stack **Polynomials, int line_number);
+void IsCoeff(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja sprawdza, czy wielomian na wierzchołku stosu jest tożsamościowo równy 0.
  * Wypisuje na standardowe wyjście 0 lub 1. Jeżeli stos jest pusty to wypisuje
  * na standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
  */
-void IsZero(Stack **Polynomials, int line_number);
+void IsZero(Stack *Polynomials, int line_number);
 
 /**
- * Funkcja wstawia na stos kopię wielomianu z wierzchołka.
- * Jeżeli stos jest pusty to wypisuje na standardowe wyjście diagnostyczne:
- * ERROR w STACK UNDERFLOW\n.
+ * Funkcja wstawia na stos kopię wielomianu z wierzchołka. Na leniwym
+ * stosie obie pozycje współdzielą jedno wyrażenie. Jeżeli stos jest pusty
+ * to wypisuje na standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
  */
-void Clone(Stack **Polynomials, int line_number);
+void Clone(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja dodaje/mnoży/odejmuje dwa wielomiany z wierzchu stosu,
  * usuwa je i wstawia na wierzchołek stosu ich sumę/iloczyn/różnicę,
- * w zależnośći od identyfikatora instrukcji (ID). Jeżeli stos jest
+ * w zależnośći od identyfikatora instrukcji (ID). Na leniwym stosie
+ * wstawia niewyliczone wyrażenie (zob. expr.h). Jeżeli stos jest
  * pusty to wypisuje na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void AddSubOrMul(Stack **Polynomials, int line_number, char ID);
+void AddSubOrMul(Stack *Polynomials, int line_number, char ID);
 
 /**
- * Funkcja neguje wielomian na wierzchołku stosu. Jeżeli stos jest
- * pusty to wypisuje na standardowe wyjście diagnostyczne:
+ * Funkcja zdejmuje ze stosu count wielomianów i wstawia na wierzchołek ich
+ * sumę, liczoną jednym wywołaniem PolyAddMany (dla count równego 0 wstawia
+ * wielomian zerowy). Na leniwym stosie wstawia niewyliczoną sumę. Jeżeli na
+ * stosie jest mniej niż count wielomianów, stos pozostaje bez zmian
+ * i wypisujemy na standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void AddMany(Stack *Polynomials, size_t count, int line_number);
+
+/**
+ * Funkcja ustawia największą liczbę wątków, których PolyMulMany używa
+ * w instrukcjach MulMany wykonywanych przez bieżący wątek. Domyślnie jest
+ * to 1, czyli mnożenie bez nowych wątków.
+ */
+void SetMulThreads(size_t threads);
+
+/**
+ * Funkcja zdejmuje ze stosu count wielomianów i wstawia na wierzchołek ich
+ * iloczyn, liczony przez PolyMulMany z wątkami w liczbie ustawionej przez
+ * SetMulThreads (dla
+ * count równego 0 wstawia wielomian 1). Na leniwym stosie najpierw wylicza
+ * mnożone wyrażenia. Jeżeli na stosie jest mniej niż count wielomianów, stos
+ * pozostaje bez zmian i wypisujemy na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void Neg(Stack **Polynomials, int line_number);
+void MulMany(Stack *Polynomials, size_t count, int line_number);
+
+/**
+ * Funkcja neguje wielomian na wierzchołku stosu, a na leniwym stosie
+ * wyrażenie z wierzchołka. Jeżeli stos jest pusty to wypisuje na
+ * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Neg(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja sprawdza, czy dwa wielomiany na wierzchu stosu są równe.
@@ -57,7 +85,7 @@ void Neg(Stack **Polynomials, int line_number);
  * pusty to wypisuje na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void IsEq(Stack **Polynomials, int line_number);
+void IsEq(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja wypisuje na standardowe wyjście stopień wielomianu
@@ -65,44 +93,175 @@ void IsEq(Stack **Polynomials, int line_number);
  * pusty to wypisuje na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void Deg(Stack **Polynomials, int line_number);
+void Deg(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja usuwa wielomian z wierzchołka stosu. Jeżeli stos jest
  * pusty to wypisuje na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void PopPoly(Stack **Polynomials, int line_number);
+void PopPoly(Stack *Polynomials, int line_number);
 
 /**
- * Funkcja wypisuje na standardowe wyjście wielomian z wierzchołka stosu.
+ * Funkcja wypisuje na standardowe wyjście wielomian z wierzchołka stosu,
+ * przekazując go wątkowi wyjścia bez kopiowania (zob. OutputExpr).
  * Jeżeli stos jest pusty to wypisuje na standardowe wyjście diagnostyczne:
  * ERROR w STACK UNDERFLOW\n.
  */
-void Print(Stack **Polynomials, int line_number);
+void Print(Stack *Polynomials, int line_number);
 
 /**
  * Funkcja wypisuje na standardowe wyjście stopień wielomianu ze względu
  * na zmienną o numerze idx. Jeżeli stos jest pusty to wypisuje na
  * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
  */
-void DegBy(Stack **Polynomials, unsigned long idx, int line_number);
+void DegBy(Stack *Polynomials, unsigned long idx, int line_number);
 
 /**
  * Funkcja wylicza wartość wielomianu w punkcie x, usuwa wielomian z wierzchołka
  * i wstawia na stos wynik operacji. Jeżeli stos jest pusty to wypisuje na
  * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
  */
-void At(Stack **Polynomials, long x, int line_number);
+void At(Stack *Polynomials, long x, int line_number);
 
 /**
  * Funkcja wykonuje operacje składania wielomianu. Wstawia na stos wynik operacji.
- * Pobiera ze stosu po kolei wielomiany, które podstawimy za zmienne w wielomianie
- * głównym (pierwszym zdjętym ze stosu). Jeżeli w którymkolwiek momencie ściągania
- * wielomianów ze stosu, stos jest pusty, to odkładamy wszystkie z powrotem i
- * wypisujemy na standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ * Wielomianem głównym jest wierzchołek stosu, a pod zmienne podstawiamy count
+ * wielomianów leżących pod nim, czytanych w miejscu. Jeżeli na stosie jest mniej
+ * niż count + 1 wielomianów, stos pozostaje bez zmian i wypisujemy na
+ * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Compose(Stack *Polynomials, size_t count, int line_number);
+
+/**
+ * Funkcja podnosi wielomian z wierzchołka stosu do potęgi exp, usuwa go
+ * i wstawia na stos wynik operacji. Jeżeli stos jest pusty to wypisuje na
+ * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n, a jeżeli
+ * wykładnik wyniku nie mieściłby się w typie poly_exp_t (zob. PolyPowFits),
+ * to ERROR w POW WRONG EXPONENT\n, nie zmieniając stosu.
+ */
+void Pow(Stack *Polynomials, poly_exp_t exp, int line_number);
+
+/**
+ * Funkcja zastępuje trzy wielomiany z wierzchołka stosu, a (wierzchołek),
+ * b i c, jednym wielomianem a * b + c, więc stos zmniejsza się o dwa.
+ * Zdejmuje tylko a i b, a iloczyn dodaje w miejscu do c, które zostaje
+ * na wierzchołku.
+ * Na leniwym stosie wstawia wyrażenie c + a * b zbudowane przez ExprAdd
+ * i ExprMul, a na zwykłym liczy wynik przez PolyFma.
+ * Jeżeli na stosie są mniej niż trzy wielomiany to wypisuje na standardowe
+ * wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void MulAdd(Stack *Polynomials, int line_number);
+
+/**
+ * Funkcja zamienia miejscami dwa wielomiany z wierzchu stosu. Jeżeli na
+ * stosie są mniej niż dwa wielomiany to wypisuje na standardowe wyjście
+ * diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Swap(Stack *Polynomials, int line_number);
+
+/**
+ * Funkcja przenosi trzeci wielomian od wierzchu stosu na wierzchołek.
+ * Jeżeli na stosie są mniej niż trzy wielomiany to wypisuje na standardowe
+ * wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Rot(Stack *Polynomials, int line_number);
+
+/**
+ * Funkcja wstawia na wierzchołek kopię wielomianu leżącego k pozycji pod nim
+ * (PICK 0 działa jak CLONE), zostawiając oryginał na miejscu. Na leniwym
+ * stosie kopia jest współdzieloną referencją do wyrażenia. Jeżeli na stosie
+ * jest nie więcej niż k wielomianów to wypisuje na standardowe wyjście
+ * diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Pick(Stack *Polynomials, size_t k, int line_number);
+
+/**
+ * Funkcja usuwa count wielomianów z wierzchu stosu. Jeżeli na stosie jest
+ * mniej niż count wielomianów, stos pozostaje bez zmian i wypisujemy na
+ * standardowe wyjście diagnostyczne: ERROR w STACK UNDERFLOW\n.
+ */
+void Drop(Stack *Polynomials, size_t count, int line_number);
+
+/**
+ * Funkcja wykonuje parę instrukcji CLONE, POP, która nie zmienia stosu.
+ * Jeżeli stos jest pusty to wypisuje na standardowe wyjście diagnostyczne
+ * komunikaty ERROR w STACK UNDERFLOW\n dla obu linii.
+ */
+void ClonePop(Stack *Polynomials, int clone_line, int pop_line);
+
+/**
+ * Funkcja wykonuje parę instrukcji NEG, ADD, zastępując dwa wielomiany
+ * z wierzchu stosu różnicą drugiego i pierwszego, liczoną jednym
+ * wywołaniem PolySub. Na leniwym stosie i przy mniej niż dwóch wielomianach
+ * wykonuje obie instrukcje po kolei, z ich komunikatami o błędach.
+ */
+void NegAdd(Stack *Polynomials, int neg_line, int add_line);
+
+/**
+ * Funkcja wykonuje parę instrukcji CLONE, MUL, zastępując wielomian
+ * z wierzchołka jego kwadratem liczonym przez PolySquare. Na leniwym
+ * i pustym stosie wykonuje obie instrukcje po kolei.
+ */
+void CloneMul(Stack *Polynomials, int clone_line, int mul_line);
+
+/**
+ * Funkcja wykonuje parę instrukcji CLONE, AT x, wstawiając na stos wartość
+ * wielomianu z wierzchołka w punkcie x bez kopiowania go. Na leniwym
+ * i pustym stosie wykonuje obie instrukcje po kolei.
+ */
+void CloneAt(Stack *Polynomials, long x, int clone_line, int at_line);
+
+/**
+ * Funkcja wypisuje na standardowe wyjście liczbę wielomianów na stosie.
+ */
+void PrintDepth(Stack *Polynomials);
+
+/**
+ * Funkcja wypisuje na standardowe wyjście diagnostyczne statystyki sesji
+ * w formacie JSON (zob. stats.h). Jeśli sesja nie zbiera statystyk, to
+ * wypisuje na standardowe wyjście diagnostyczne: ERROR w STATS DISABLED\n.
+ */
+void PrintStats(int line_number);
+
+/**
+ * Funkcja zdejmuje wielomian z wierzchołka stosu i przenosi go, bez
+ * kopiowania i bez liczenia leniwego wyrażenia, do rejestru o nazwie złożonej z @p name_length znaków
+ * zaczynających się w @p name, zastępując poprzednią zawartość rejestru.
+ * Jeżeli stos jest pusty to wypisuje na standardowe wyjście diagnostyczne:
+ * ERROR w STACK UNDERFLOW\n.
+ */
+void Store(Stack *Polynomials, Registers *Memory, const char *name,
+           size_t name_length, int line_number);
+
+/**
+ * Funkcja wstawia na stos wielomian z rejestru o podanej nazwie jako
+ * referencję współdzieloną z rejestrem, bez kopiowania. Wielomian jest
+ * kopiowany dopiero wtedy, gdy instrukcja chce go zmienić w miejscu,
+ * a rejestr nadal go przechowuje (zob. Peek w stack.h).
+ * @return false, jeśli nie ma rejestru o podanej nazwie
+ */
+bool Recall(Stack *Polynomials, const Registers *Memory, const char *name,
+            size_t name_length);
+
+/**
+ * Funkcja zapisuje cały stos do pliku w formacie binarnym PolySerialize,
+ * od wielomianu na dnie stosu do wielomianu na wierzchołku. Nie zmienia stosu.
+ * Nazwa pliku to @p path_length znaków zaczynających się w @p path.
+ * @return false, jeśli nie udało się zapisać pliku
+ */
+bool Save(Stack *Polynomials, const char *path, size_t path_length);
+
+/**
+ * Funkcja wczytuje wielomiany z pliku zapisanego przez Save i wstawia je na
+ * stos w kolejności z pliku, odtwarzając zapisany stos na wierzchu obecnego.
+ * Plik jest odwzorowywany w pamięci i odczytywany bez kopiowania. Jeżeli
+ * którykolwiek rekord jest niepoprawny, stos pozostaje bez zmian.
+ * Nazwa pliku to @p path_length znaków zaczynających się w @p path.
+ * @return false, jeśli nie udało się wczytać pliku
  */
-void Compose(Stack **Polynomials, size_t count, int line_number);
+bool Load(Stack *Polynomials, const char *path, size_t path_length);
 
 #endif /* __INSTRUCTIONS_H__ */
 
@@ -0,0 +1,406 @@
+/** @file
+  Implementacja buforowanego wyjścia kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "output.h"
+#include "characters.h"
+#include "queue.h"
+#include "protocol.h"
+#include "stats.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define OUTPUT_FLUSH_SIZE (1 << 16)     ///< Rozmiar bufora, od którego go wypisujemy.
+#define ERROR_PREFIX "ERROR "           ///< Początek komunikatu o błędzie.
+#define EVENT_QUEUE_SIZE 1024           ///< Rozmiar kolejki zdarzeń wyjścia.
+#define BYTE_BITS 8                     ///< Liczba bitów w bajcie.
+#define LINE_NUMBER_SIZE 4              ///< Długość numeru ramki w ramce błędu.
+
+/**
+ * To jest struktura przechowująca buforowany strumień wyjścia.
+ */
+typedef struct OutputStream {
+    PolyBuffer buffer;  ///< dane czekające na wypisanie
+    int fd;             ///< deskryptor strumienia
+    int interactive;    ///< czy strumień jest terminalem (-1, jeśli nie wiadomo)
+} OutputStream;
+
+/**
+ * Rodzaje zdarzeń przekazywanych do wątku wyjścia.
+ */
+typedef enum EventKind {
+    EVENT_POLY,         ///< wypisanie wielomianu
+    EVENT_EXPR,         ///< wypisanie wartości wyrażenia
+    EVENT_NUMBER,       ///< wypisanie liczby
+    EVENT_ERROR,        ///< wypisanie komunikatu o błędzie
+    EVENT_REPORT,       ///< wypisanie raportu
+    EVENT_END           ///< koniec pracy wątku
+} EventKind;
+
+/**
+ * To jest struktura przechowująca zdarzenie wyjścia.
+ */
+typedef struct OutputEvent {
+    EventKind kind;             ///< rodzaj zdarzenia
+    Poly poly;                  ///< wielomian na własność wątku wyjścia
+    Expr *expr;                 ///< referencja wątku wyjścia do wyrażenia
+    long number;                ///< liczba lub numer linii
+    const char *message;        ///< komunikat o błędzie, stały napis
+    char *text;                 ///< raport na własność wątku wyjścia
+} OutputEvent;
+
+/**
+ * To jest struktura przechowująca wyjście: strumień wyników, strumień
+ * komunikatów o błędach i, jeśli działa, wątek wyjścia.
+ */
+typedef struct Output {
+    OutputStream out;       ///< strumień wyników
+    OutputStream err;       ///< strumień komunikatów o błędach
+    bool shared;            ///< czy komunikaty o błędach idą do strumienia wyników
+    bool binary;            ///< czy wyniki są ramkami protokołu binarnego
+    bool threaded;          ///< czy wyniki formatuje osobny wątek wyjścia
+    Queue events;           ///< kolejka zdarzeń do wątku wyjścia
+    pthread_t thread;       ///< wątek wyjścia
+    StatsScope scope;       ///< statystyki wątku, który uruchomił wątek wyjścia
+} Output;
+
+/// Wyjście na standardowe wyjście i standardowe wyjście diagnostyczne.
+static Output standard = {
+    .out = {.buffer = {NULL, 0, 0}, .fd = STDOUT_FILENO, .interactive = -1},
+    .err = {.buffer = {NULL, 0, 0}, .fd = STDERR_FILENO, .interactive = -1},
+    .shared = false,
+    .binary = false,
+    .threaded = false
+};
+
+/// Wyjście przekierowane przez bieżący wątek lub NULL.
+static _Thread_local Output *redirected = NULL;
+
+/**
+ * Funkcja zwraca wyjście bieżącego wątku.
+ */
+static Output *Current(void) {
+    if (redirected != NULL) return redirected;
+    else return &standard;
+}
+
+/**
+ * Funkcja wypisuje całą zawartość bufora strumienia.
+ */
+static void StreamFlush(OutputStream *s) {
+    size_t written = 0;
+    while (written < s->buffer.size) {
+        ssize_t count = write(s->fd, s->buffer.data + written, s->buffer.size - written);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += count;
+    }
+    s->buffer.size = 0;
+}
+
+/**
+ * Funkcja dopisuje do bufora strumienia @p size znaków.
+ */
+static void StreamAppend(OutputStream *s, const char *data, size_t size) {
+    PolyBuffer *buffer = &s->buffer;
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? OUTPUT_FLUSH_SIZE : buffer->capacity;
+        while (capacity < buffer->size + size) capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        if (buffer->data == NULL) exit(1);
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+/**
+ * Funkcja dopisuje do bufora strumienia liczbę. Liczbę formatujemy tak
+ * jak wielomian stały.
+ */
+static void StreamAppendNumber(OutputStream *s, long value) {
+    Poly coeff = PolyFromCoeff(value);
+    PolyFormat(&coeff, &s->buffer);
+}
+
+/**
+ * Funkcja kończy rekord w strumieniu. Jeśli bufor jest już duży albo
+ * strumień jest terminalem, wypisuje jego zawartość.
+ */
+static void StreamEndRecord(OutputStream *s) {
+    if (s->interactive == -1) s->interactive = isatty(s->fd);
+    if (s->buffer.size >= OUTPUT_FLUSH_SIZE || s->interactive) StreamFlush(s);
+}
+
+/**
+ * Funkcja kończy linię w strumieniu.
+ */
+static void StreamEndLine(OutputStream *s) {
+    char endl = ENDL;
+    StreamAppend(s, &endl, 1);
+    StreamEndRecord(s);
+}
+
+/**
+ * Funkcja dopisuje do bufora strumienia liczbę zapisaną na @p size bajtach
+ * w kolejności little-endian.
+ */
+static void StreamAppendLittleEndian(OutputStream *s, unsigned long value,
+                                     size_t size) {
+    char bytes[FRAME_NUMBER_SIZE];
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = (char)(value >> (BYTE_BITS * i));
+    }
+    StreamAppend(s, bytes, size);
+}
+
+/**
+ * Funkcja zaczyna w strumieniu ramkę rodzaju @p kind o danych długości
+ * @p size.
+ */
+static void StreamBeginFrame(OutputStream *s, FrameKind kind, size_t size) {
+    char byte = (char)kind;
+    StreamAppend(s, &byte, 1);
+    StreamAppendLittleEndian(s, size, FRAME_LENGTH_SIZE);
+}
+
+/**
+ * Funkcja dopisuje do strumienia wyników sformatowany wielomian.
+ */
+static void WritePoly(Output *o, const Poly *p) {
+    TraceBegin(TRACE_PHASE, "print");
+    if (o->binary) {
+        // Długość rekordu poznajemy dopiero po jego zapisaniu, więc
+        // uzupełniamy ją w nagłówku ramki na końcu.
+        StreamBeginFrame(&o->out, FRAME_POLY, 0);
+        size_t begin = o->out.buffer.size;
+        PolySerialize(p, &o->out.buffer);
+        size_t size = o->out.buffer.size - begin;
+        for (size_t i = 0; i < FRAME_LENGTH_SIZE; i++) {
+            o->out.buffer.data[begin - FRAME_LENGTH_SIZE + i] =
+                (char)(size >> (BYTE_BITS * i));
+        }
+        StreamEndRecord(&o->out);
+    }
+    else {
+        PolyFormat(p, &o->out.buffer);
+        StreamEndLine(&o->out);
+    }
+    TraceEnd(TRACE_PHASE);
+}
+
+/**
+ * Funkcja dopisuje do strumienia wyników liczbę.
+ */
+static void WriteNumber(Output *o, long value) {
+    if (o->binary) {
+        StreamBeginFrame(&o->out, FRAME_NUMBER, FRAME_NUMBER_SIZE);
+        StreamAppendLittleEndian(&o->out, value, FRAME_NUMBER_SIZE);
+        StreamEndRecord(&o->out);
+        return;
+    }
+    StreamAppendNumber(&o->out, value);
+    StreamEndLine(&o->out);
+}
+
+/**
+ * Funkcja dopisuje do strumienia komunikatów o błędach komunikat.
+ */
+static void WriteError(Output *o, int line_number, const char *message) {
+    OutputStream *err = o->shared ? &o->out : &o->err;
+    if (o->binary) {
+        size_t length = strlen(message);
+        StreamBeginFrame(err, FRAME_ERROR, LINE_NUMBER_SIZE + length);
+        StreamAppendLittleEndian(err, line_number, LINE_NUMBER_SIZE);
+        StreamAppend(err, message, length);
+        StreamEndRecord(err);
+        return;
+    }
+    StreamAppend(err, ERROR_PREFIX, strlen(ERROR_PREFIX));
+    StreamAppendNumber(err, line_number);
+    char space = ' ';
+    StreamAppend(err, &space, 1);
+    StreamAppend(err, message, strlen(message));
+    StreamEndLine(err);
+}
+
+/**
+ * Funkcja dopisuje do strumienia komunikatów o błędach raport. W protokole
+ * binarnym raport jest ramką błędu.
+ */
+static void WriteReport(Output *o, int line_number, const char *text) {
+    if (o->binary) {
+        WriteError(o, line_number, text);
+        return;
+    }
+    OutputStream *err = o->shared ? &o->out : &o->err;
+    StreamAppend(err, text, strlen(text));
+    StreamEndLine(err);
+}
+
+/**
+ * Funkcja wątku wyjścia. Obsługuje zdarzenia w kolejności, w jakiej
+ * zostały zgłoszone, aż do zdarzenia EVENT_END.
+ */
+static void *OutputThread(void *arg) {
+    Output *o = arg;
+    // Wielomiany z wypisanych zdarzeń należą do statystyk sesji.
+    StatsAttach(o->scope);
+    OutputEvent event;
+    do {
+        QueuePop(&o->events, &event);
+        switch (event.kind) {
+            case EVENT_POLY:
+                WritePoly(o, &event.poly);
+                PolyDestroy(&event.poly);
+                break;
+            case EVENT_EXPR:
+                WritePoly(o, ExprValue(event.expr));
+                ExprRelease(event.expr);
+                break;
+            case EVENT_NUMBER:
+                WriteNumber(o, event.number);
+                break;
+            case EVENT_ERROR:
+                WriteError(o, (int)event.number, event.message);
+                break;
+            case EVENT_REPORT:
+                WriteReport(o, (int)event.number, event.text);
+                free(event.text);
+                break;
+            case EVENT_END:
+                break;
+        }
+    } while (event.kind != EVENT_END);
+    return NULL;
+}
+
+void OutputRedirect(int out_fd, int err_fd) {
+    Output *o = aligned_alloc(_Alignof(Output), sizeof(Output));
+    if (o == NULL) exit(1);
+    *o = (Output) {
+        .out = {.buffer = {NULL, 0, 0}, .fd = out_fd, .interactive = -1},
+        .err = {.buffer = {NULL, 0, 0}, .fd = err_fd, .interactive = -1},
+        .shared = (out_fd == err_fd),
+        .binary = false,
+        .threaded = false
+    };
+    redirected = o;
+}
+
+void OutputSetBinary(void) {
+    Output *o = Current();
+    o->binary = true;
+    o->shared = true;
+    StreamAppend(&o->out, PROTOCOL_MAGIC, PROTOCOL_MAGIC_SIZE);
+}
+
+void OutputStart(void) {
+    Output *o = Current();
+    QueueInit(&o->events, sizeof(OutputEvent), EVENT_QUEUE_SIZE);
+    o->scope = StatsCurrent();
+    if (pthread_create(&o->thread, NULL, OutputThread, o) != 0) exit(1);
+    o->threaded = true;
+}
+
+bool OutputThreaded(void) {
+    return Current()->threaded;
+}
+
+void OutputPoly(const Poly *p) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_POLY, .poly = PolyClone(p)};
+        QueuePush(&o->events, &event);
+    }
+    else {
+        WritePoly(o, p);
+    }
+}
+
+void OutputExpr(Expr *e) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_EXPR, .expr = e};
+        QueuePush(&o->events, &event);
+    }
+    else {
+        WritePoly(o, ExprValue(e));
+        ExprRelease(e);
+    }
+}
+
+void OutputNumber(long value) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_NUMBER, .number = value};
+        QueuePush(&o->events, &event);
+    }
+    else {
+        WriteNumber(o, value);
+    }
+}
+
+void OutputError(int line_number, const char *message) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_ERROR, .number = line_number,
+                             .message = message};
+        QueuePush(&o->events, &event);
+    }
+    else {
+        WriteError(o, line_number, message);
+    }
+}
+
+void OutputReport(int line_number, char *text) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_REPORT, .number = line_number,
+                             .text = text};
+        QueuePush(&o->events, &event);
+    }
+    else {
+        WriteReport(o, line_number, text);
+        free(text);
+    }
+}
+
+void OutputSync(void) {
+    Output *o = Current();
+    if (!o->threaded) {
+        StreamFlush(&o->out);
+        StreamFlush(&o->err);
+    }
+}
+
+void OutputFlush(void) {
+    Output *o = Current();
+    if (o->threaded) {
+        OutputEvent event = {.kind = EVENT_END};
+        QueuePush(&o->events, &event);
+        pthread_join(o->thread, NULL);
+        QueueDestroy(&o->events);
+        o->threaded = false;
+    }
+    StreamFlush(&o->out);
+    StreamFlush(&o->err);
+    free(o->out.buffer.data);
+    free(o->err.buffer.data);
+    o->out.buffer = (PolyBuffer) {NULL, 0, 0};
+    o->err.buffer = (PolyBuffer) {NULL, 0, 0};
+    if (o == redirected) {
+        free(o);
+        redirected = NULL;
+    }
+}
@@ -0,0 +1,94 @@
+/** @file
+  Interfejs buforowanego wyjścia kalkulatora. Wyniki i komunikaty o błędach
+  są zbierane w buforach i wypisywane dużymi porcjami wywołaniem write.
+  Jeśli wyjście jest terminalem, każda linia jest wypisywana od razu.
+  Po wywołaniu OutputStart formatowaniem i wypisywaniem zajmuje się osobny
+  wątek, a funkcje Output* jedynie przekazują mu zdarzenia w kolejności
+  wywołań, więc wyjście jest takie samo jak przy pracy w jednym wątku.
+  Wątek może przekierować swoje wyjście do innych deskryptorów przez
+  OutputRedirect; pozostałe wątki nadal piszą na standardowe wyjścia.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include "poly.h"
+#include "expr.h"
+
+/**
+ * Funkcja przekierowuje wyjście bieżącego wątku: wyniki trafiają do
+ * deskryptora @p out_fd, a komunikaty o błędach do @p err_fd. Przekierowanie
+ * trwa do wywołania OutputFlush. Deskryptory zamyka wywołujący.
+ */
+void OutputRedirect(int out_fd, int err_fd);
+
+/**
+ * Funkcja przełącza wyjście bieżącego wątku na protokół binarny
+ * (zob. protocol.h): wypisuje nagłówek strumienia, a od tej chwili wyniki
+ * i komunikaty o błędach trafiają jako ramki do strumienia wyników.
+ */
+void OutputSetBinary(void);
+
+/**
+ * Funkcja uruchamia wątek wyjścia dla wyjścia bieżącego wątku. Do wywołania
+ * OutputFlush funkcje Output* wywołuje tylko ten wątek.
+ */
+void OutputStart(void);
+
+/**
+ * Funkcja sprawdza, czy wyniki bieżącego wątku wypisuje wątek wyjścia.
+ */
+bool OutputThreaded(void);
+
+/**
+ * Funkcja dopisuje do standardowego wyjścia wielomian i znak '\n'.
+ * Jeśli działa wątek wyjścia, przekazuje mu kopię wielomianu, więc
+ * wielomiany, które nie są współczynnikami, lepiej wypisywać przez
+ * OutputExpr.
+ */
+void OutputPoly(const Poly *p);
+
+/**
+ * Funkcja dopisuje do standardowego wyjścia wartość wyliczonego wyrażenia
+ * @p e i znak '\n', przejmując referencję wywołującego. Jeśli działa wątek
+ * wyjścia, przekazuje mu referencję, więc wartość nie jest kopiowana;
+ * zostanie skopiowana tylko wtedy, gdy ktoś zechce ją zmienić, zanim wątek
+ * wyjścia ją wypisze (zob. ExprTake).
+ */
+void OutputExpr(Expr *e);
+
+/**
+ * Funkcja dopisuje do standardowego wyjścia liczbę i znak '\n'.
+ */
+void OutputNumber(long value);
+
+/**
+ * Funkcja dopisuje do standardowego wyjścia diagnostycznego komunikat
+ * ERROR w @p message, gdzie w to numer linii.
+ */
+void OutputError(int line_number, const char *message);
+
+/**
+ * Funkcja dopisuje do standardowego wyjścia diagnostycznego raport @p text
+ * i znak '\n', przejmując napis na własność. W protokole binarnym raport
+ * trafia do ramki FRAME_ERROR z numerem @p line_number.
+ */
+void OutputReport(int line_number, char *text);
+
+/**
+ * Funkcja wypisuje zawartość buforów wyjścia bieżącego wątku, nie zwalniając
+ * ich. Gdy działa wątek wyjścia, nic nie robi, bo bufory należą do niego.
+ */
+void OutputSync(void);
+
+/**
+ * Funkcja kończy pracę wątku wyjścia, jeśli działa, po czym wypisuje
+ * zawartość obu buforów i zwalnia ich pamięć. Jeśli wyjście bieżącego
+ * wątku było przekierowane, przywraca standardowe wyjścia.
+ */
+void OutputFlush(void);
+
+#endif /* __OUTPUT_H__ */
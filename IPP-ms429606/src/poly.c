@@ -6,18 +6,80 @@
 */
 
 #include "poly.h"
+#include "stats.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
 #define INITIAL_ARR_SIZE 4 ///<Stała na początkowy rozmiar tablicy.
 
+/**
+ * Stała na maksymalną liczbę jednomianów wielomianu, który potęgujemy
+ * z rozwinięcia wielomianowego.
+ */
+#define MULTINOMIAL_MAX_SIZE 4
+/**
+ * Stała na maksymalny wykładnik, do którego potęgujemy z rozwinięcia
+ * wielomianowego (ogranicza rozmiar trójkąta Pascala).
+ */
+#define MULTINOMIAL_MAX_EXP 256
+/**
+ * Stała na maksymalną liczbę składników rozwinięcia wielomianowego.
+ */
+#define MULTINOMIAL_MAX_TERMS 4096
+
+#define RADIX_BITS 8                    ///< Stała na liczbę bitów cyfry sortowania pozycyjnego.
+#define RADIX_SIZE (1 << RADIX_BITS)    ///< Stała na liczbę różnych cyfr sortowania pozycyjnego.
+/**
+ * Stała na rozmiar tablicy, od którego jednomiany sortujemy pozycyjnie
+ * zamiast przez wstawianie.
+ */
+#define RADIX_SORT_THRESHOLD 64
+
+/**
+ * Stała na łączną liczbę jednomianów mnożonych wielomianów, od której
+ * PolyMulMany liczy poddrzewa iloczynu w osobnych wątkach.
+ */
+#define MUL_PARALLEL_THRESHOLD 64
+/**
+ * Stałe na ułamek (licznik i mianownik), poniżej którego stosunek liczby
+ * współczynników iloczynu dwóch pierwszych wielomianów do iloczynu ich liczb
+ * współczynników oznacza, że PolyMulMany mnoży wielomiany po kolei.
+ */
+#define MUL_COLLAPSE_NUMERATOR 3
+#define MUL_COLLAPSE_DENOMINATOR 4  ///< Zob. MUL_COLLAPSE_NUMERATOR.
+
+#define FORMAT_INITIAL_SIZE 64  ///< Stała na początkowy rozmiar bufora PolyFormat.
+#define LONG_MAX_DIGITS 20      ///< Stała na maksymalną liczbę cyfr liczby typu long.
+#define DECIMAL_BASE 10         ///< Stała oznaczająca bazę systemu dziesiątkowego.
+#define ASCII_ZERO '0'          ///< Stała oznaczająca znak '0'.
+
+#define SERIAL_MAGIC "POLY"             ///< Sygnatura rekordu binarnego.
+#define SERIAL_MAGIC_SIZE 4             ///< Długość sygnatury rekordu binarnego.
+#define SERIAL_VERSION 1                ///< Wersja formatu binarnego.
+#define SERIAL_U64_SIZE 8               ///< Liczba bajtów liczby 64-bitowej.
+/// Stała na długość nagłówka rekordu: sygnatura, wersja i długość drzewa.
+#define SERIAL_HEADER_SIZE (SERIAL_MAGIC_SIZE + 1 + SERIAL_U64_SIZE)
+#define SERIAL_MAX_DEPTH 10000          ///< Największa głębokość odczytywanego drzewa.
+#define VARINT_MAX_SIZE 10              ///< Maksymalna długość liczby o zmiennej długości.
+#define VARINT_BITS 7                   ///< Liczba bitów danych w bajcie liczby.
+#define VARINT_MASK 0x7f                ///< Maska bitów danych w bajcie liczby.
+#define VARINT_MORE 0x80                ///< Bit oznaczający kolejny bajt liczby.
+#define BYTE_BITS 8                     ///< Liczba bitów w bajcie.
+#define BYTE_MASK 0xff                  ///< Maska bajtu.
+#define FNV_OFFSET 14695981039346656037UL   ///< Wartość początkowa skrótu FNV-1a.
+#define FNV_PRIME 1099511628211UL           ///< Mnożnik skrótu FNV-1a.
+
 void PolyDestroy(Poly *p) {
     assert(p != NULL);
     if (p->arr != NULL) {
         for (size_t i = 0; i < p->size; i++) {
             MonoDestroy(&(p->arr[i]));
         }
-        free(p->arr);
+        MonosFree(p->arr);
     }
 }
 
@@ -30,7 +92,7 @@ Poly PolyClone(const Poly *p) {
     }
     else {
         clone.size = p->size;
-        clone.arr = malloc(clone.size * sizeof(Mono));
+        clone.arr = MonosAlloc(clone.size);
         if (clone.arr == NULL) exit(1);
         for (size_t i = 0; i < clone.size; i++) {
             clone.arr[i] = MonoClone(&(p->arr[i]));
@@ -46,7 +108,7 @@ Poly PolyClone(const Poly *p) {
 static void AddSizeIfNeeded(Mono **m, size_t res_size, size_t *current_size) {
     if (res_size == *current_size) {
         *current_size *= 2;
-        *m = realloc(*m, *current_size * sizeof(Mono));
+        *m = MonosRealloc(*m, *current_size);
         if (*m == NULL) exit(1);
     }
 }
@@ -88,7 +150,7 @@ static Poly AddArraysOfMonos(Mono *p_arr, Mono *q_arr, size_t p_size,
                              size_t q_size, size_t *res_size) {
     Poly result;
     size_t current_size = INITIAL_ARR_SIZE;
-    Mono *res = malloc(current_size * sizeof(Mono));
+    Mono *res = MonosAlloc(current_size);
     if (res == NULL) exit(1);
     // Tworzymy 3 indexy jeden będzie poruszać się po tablicy wynikowej,
     // pozostałe po p_arr i q_arr.
@@ -138,7 +200,7 @@ static Poly AddArraysOfMonos(Mono *p_arr, Mono *q_arr, size_t p_size,
                      res_arr_index, p_size, q_size, res_size, &current_size);
     if (*res_size == 0) {
         result = PolyZero();
-        free(res);
+        MonosFree(res);
         return result;
     }
     else {
@@ -159,7 +221,7 @@ static Poly AddArrayToCoeff(const Mono *p_arr, size_t p_size, const Poly *q, siz
     Mono *res;
     if (q_coeff == 0) {
     // Res staje sie poprostu kopią p_arr.
-        res = malloc(p_size * sizeof(Mono));
+        res = MonosAlloc(p_size);
         if (res == NULL) exit(1);
         *res_arr_size = p_size;
         for (size_t i = 0; i < p_size; i++) {
@@ -168,7 +230,7 @@ static Poly AddArrayToCoeff(const Mono *p_arr, size_t p_size, const Poly *q, siz
     }
     else {
         if (p_arr[0].exp == 0) {
-            res = malloc(p_size * sizeof(Mono));
+            res = MonosAlloc(p_size);
             if (res == NULL) exit(1);
             if (PolyIsCoeff(&p_arr[0].p)) {
                 if (p_arr[0].p.coeff == -q_coeff) {
@@ -200,7 +262,7 @@ static Poly AddArrayToCoeff(const Mono *p_arr, size_t p_size, const Poly *q, siz
             }
         }
         else {
-            res = malloc((p_size + 1) * sizeof(Mono));
+            res = MonosAlloc(p_size + 1);
             if (res == NULL) exit(1);
             res[0].exp = 0;
             res[0].p.arr = NULL;
@@ -233,7 +295,11 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
     }
     else {
         size_t res_size = 0;
+        TraceBegin(TRACE_OP, "PolyAdd");
+        TraceBegin(TRACE_PHASE, "merge");
         res = AddArraysOfMonos(p->arr, q->arr, p->size, q->size, &res_size);
+        TraceEnd(TRACE_PHASE);
+        TraceEnd(TRACE_OP);
     }
     // Jeżeli res.size = 1 oraz jedyny jednomian jest poprostu współczynnikiem,
     // zwracamy wielomian będący tym współczynnikiem.
@@ -248,165 +314,199 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
 }
 
 /**
- * Funkcja pomocnicza do qsorta, porównuje 2 wielomiany ze wzgledu na wykładnik.
+ * Tworzy wielomian z posortowanej tablicy niezerowych jednomianów o rozmiarze size.
+ * Przejmuje na własność tablicę arr. Pustą tablicę zamienia na wielomian zerowy,
+ * a tablicę z jednym jednomianem o wykładniku 0, będącym współczynnikiem,
+ * na ten współczynnik.
+ */
+static Poly PolyFromMonoArray(Mono *arr, size_t size) {
+    if (size == 0) {
+        MonosFree(arr);
+        return PolyZero();
+    }
+    else if (size == 1 && arr[0].exp == 0 && PolyIsCoeff(&arr[0].p)) {
+        poly_coeff_t coeff = arr[0].p.coeff;
+        MonosFree(arr);
+        return PolyFromCoeff(coeff);
+    }
+    else {
+        return (Poly) {.size = size, .arr = arr};
+    }
+}
+
+/**
+ * Usuwa w jednym przejściu jednomiany zerowe z tablicy, przesuwając pozostałe
+ * na początek. Zwraca nowy rozmiar tablicy.
  */
-static int CompareMonosByExp(const void *a, const void *b) {
-    Mono mono1 = *(Mono*)a;
-    Mono mono2 = *(Mono*)b;
+static size_t RemoveZeroMonos(Mono *arr, size_t size) {
+    size_t j = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (!PolyIsZero(&arr[i].p)) {
+            arr[j++] = arr[i];
+        }
+    }
+    return j;
+}
 
-    if (mono1.exp < mono2.exp) return -1;
-    else if (mono1.exp == mono2.exp) return 0;
-    else return 1;
+/**
+ * Sortuje w miejscu tablicę jednomianów po wykładnikach przez wstawianie.
+ * Używane dla krótkich tablic.
+ */
+static void InsertionSortMonos(Mono *monos, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        Mono mono = monos[i];
+        size_t j = i;
+        while (j > 0 && monos[j - 1].exp > mono.exp) {
+            monos[j] = monos[j - 1];
+            j--;
+        }
+        monos[j] = mono;
+    }
 }
 
 /**
- * Funkcja usuwa jednomiany zerowe (o wspolczynniku = 0) z tablicy wielomianu.
+ * Sortuje tablicę jednomianów po wykładnikach sortowaniem pozycyjnym (LSD),
+ * przetwarzając po RADIX_BITS bitów wykładnika. Pomija przebiegi, w których
+ * wszystkie jednomiany mają tę samą cyfrę, więc dla małych wykładników
+ * wykonuje zwykle jeden przebieg.
  */
-static void PolyRemoveZeros(Poly *p) {
-    /* Licznik znalezionych zer - każdy element w tablicy będziemy przesuwać
-       o ilość zer go poprzedzających. */
-    if (PolyIsCoeff(p)) return;
-    size_t counter = 0;
+static void RadixSortMonos(Mono *monos, size_t count, poly_exp_t max_exp) {
+    Mono *buffer = MonosAlloc(count);
+    if (buffer == NULL) exit(1);
+    Mono *from = monos;
+    Mono *to = buffer;
+    for (unsigned shift = 0; shift < sizeof(poly_exp_t) * 8 && (max_exp >> shift) > 0;
+         shift += RADIX_BITS) {
+        size_t counts[RADIX_SIZE] = {0};
+        for (size_t i = 0; i < count; i++) {
+            counts[(from[i].exp >> shift) & (RADIX_SIZE - 1)]++;
+        }
+        if (counts[(from[0].exp >> shift) & (RADIX_SIZE - 1)] == count) continue;
 
-    for (size_t i = 0; i < p->size; i++) {
-        if (PolyIsZero(&p->arr[i].p)) {
-            counter++;
+        size_t position = 0;
+        for (size_t d = 0; d < RADIX_SIZE; d++) {
+            size_t digit_count = counts[d];
+            counts[d] = position;
+            position += digit_count;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[counts[(from[i].exp >> shift) & (RADIX_SIZE - 1)]++] = from[i];
         }
-        else if (counter > 0) { // Przesuwamy element i-ty o ilość znalezionych zer.
-            p->arr[i - counter] = p->arr[i];
+        Mono *helper = from;
+        from = to;
+        to = helper;
+    }
+    if (from != monos) {
+        for (size_t i = 0; i < count; i++) {
+            monos[i] = from[i];
         }
     }
-    p->size -= counter;
-    if (p->size == 0) { // Wszystkie elementy były zerami.
-        free(p->arr);
-        p->arr = NULL;
-        p->coeff = 0;
+    MonosFree(buffer);
+}
+
+/**
+ * Sortuje tablicę jednomianów po wykładnikach. Najpierw w czasie liniowym
+ * sprawdza, czy tablica jest już posortowana (tak jest np. dla wielomianów
+ * wypisanych przez PolyPrint lub iloczynów przez jednomian).
+ */
+static void SortMonos(Mono *monos, size_t count) {
+    bool sorted = true;
+    poly_exp_t max_exp = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && monos[i - 1].exp > monos[i].exp) sorted = false;
+        if (monos[i].exp > max_exp) max_exp = monos[i].exp;
     }
+    if (sorted) return;
+    if (count < RADIX_SORT_THRESHOLD) InsertionSortMonos(monos, count);
+    else RadixSortMonos(monos, count, max_exp);
 }
 
+static Poly PolyBuildMonos(size_t count, Mono *monos);
 
 /**
- * Funkcja pomocnicza do PolyAddMonos, tworzy wielomian z jednomianu.
- * Wywoływana w PolyFromMonos gdy liczba jednomianów = 1.
+ * Sumuje współczynniki run_size jednomianów o tym samym wykładniku jednym
+ * dodawaniem k-argumentowym. Przejmuje na własność współczynniki jednomianów.
+ * Jednomiany wszystkich współczynników przenosimy (bez kopiowania) do jednej
+ * tablicy, a współczynniki liczbowe traktujemy jak jednomiany o wykładniku 0.
+ * Tak powstałą tablicę budujemy rekurencyjnie przez PolyBuildMonos.
  */
-static Poly PolyFromMono(Mono m) {
-    PolyRemoveZeros(&(m.p)); // Usuwamy wielomiany o zerowych współczynnikach.
-    if (m.exp == 0 && PolyIsCoeff(&m.p)) {
-        poly_coeff_t new_coeff = m.p.coeff;
-        return PolyFromCoeff(new_coeff);
+static Poly PolySumRun(Mono *run, size_t run_size) {
+    size_t total = 0;
+    bool all_coeffs = true;
+    for (size_t i = 0; i < run_size; i++) {
+        if (PolyIsCoeff(&run[i].p)) {
+            total++;
+        }
+        else {
+            total += run[i].p.size;
+            all_coeffs = false;
+        }
     }
-    else if (PolyIsZero(&m.p)) {
-        return PolyZero();
+    if (all_coeffs) {
+        unsigned long sum = 0;
+        for (size_t i = 0; i < run_size; i++) {
+            sum += (unsigned long)run[i].p.coeff;
+        }
+        return PolyFromCoeff((poly_coeff_t)sum);
     }
-    else {
-        Poly result;
-        result.arr = malloc(sizeof(Mono));
-        if (result.arr == NULL) exit(1);
-        result.size = 1;
-        result.arr[0] = m;
 
-        if (!PolyIsCoeff(&m.p) && m.p.size == 1) {
-            if (m.p.arr[0].exp == 0 && PolyIsCoeff(&(m.p.arr[0].p))) {
-                poly_coeff_t coeff = m.p.arr[0].p.coeff;
-                MonoDestroy(&m);
-                result.arr[0].p = PolyFromCoeff(coeff);
+    Mono *inner = MonosAlloc(total);
+    if (inner == NULL) exit(1);
+    size_t inner_size = 0;
+    for (size_t i = 0; i < run_size; i++) {
+        if (PolyIsCoeff(&run[i].p)) {
+            inner[inner_size].p = run[i].p;
+            inner[inner_size].exp = 0;
+            inner_size++;
+        }
+        else {
+            for (size_t j = 0; j < run[i].p.size; j++) {
+                inner[inner_size++] = run[i].p.arr[j];
             }
+            MonosFree(run[i].p.arr);
         }
-
-        return result;
     }
+    return PolyBuildMonos(inner_size, inner);
 }
 
 /**
- * Tworzy wielomian z posortowanej tablicy jednomianów. Przejmuje na własność
- * pamięć wskazywaną przez new_monos i jej zawartość. Może dowolnie modyfikować
- * zawartość tej pamięci.
+ * Tworzy wielomian z tablicy jednomianów. Przejmuje na własność pamięć
+ * wskazywaną przez monos i jej zawartość. Sortuje jednomiany w czasie
+ * liniowym, każdą serię jednomianów o tym samym wykładniku sumuje jednym
+ * wywołaniem PolySumRun i w tym samym przejściu zapisuje wynik w miejscu,
+ * pomijając jednomiany zerowe.
  */
-static Poly PolyFromMonos(size_t count, Mono *new_monos) {
-    Poly res;
-    if (count == 1) {
-        res = PolyFromMono(new_monos[0]);
-        free(new_monos);
-        return res;
-    }
-    else {
-        Mono *newer_monos = malloc(count * sizeof(Mono));
-        if (newer_monos == NULL) exit(1);
-
-        size_t j = 0;
-        for (size_t i = 0; i < count - 1; i++) {
-            if (new_monos[i].exp == new_monos[i + 1].exp) {
-                Poly helper = PolyAdd(&new_monos[i].p, &new_monos[i + 1].p);
-                PolyDestroy(&new_monos[i].p);
-                PolyDestroy(&new_monos[i + 1].p);
-                if (!PolyIsZero(&helper)) {
-                    newer_monos[j].exp = new_monos[i].exp;
-                    newer_monos[j].p = helper;
-                    i += 2;
-                    // Aby i-ty jednomian był pierwszym nie sprawdzonym wcześniej.
-                    if (i <= count - 1) {
-                        while (i < count && new_monos[i].exp == newer_monos[j].exp) {
-                        // Dopóki wykładniki kolejnych jednomianów są takie same, dodaję
-                        // do newer_monos[j].p każdy kolejny wielomian jednomianu.
-                            Poly helper2 = newer_monos[j].p;
-                            newer_monos[j].p = PolyAdd(&helper2, &new_monos[i].p);
-                            PolyDestroy(&helper2);
-                            PolyDestroy(&new_monos[i].p);
-                            i++;
-                        }
-                        if (PolyIsZero(&newer_monos[j].p)) {
-                        // Zmniejszam 'j' i niszczę wielomian tak aby dalej 'j' było takie samo.
-                            PolyDestroy(&newer_monos[j].p);
-                            j--;
-                        }
-                    }
-                    i--;
-                    j++;
-                }
-                // Zwiększam 'i' o 1, żeby w pętli for przejść o 2 do przodu, tak aby
-                // nie sprawdzać tych dwóch jednomianów co wcześniej.
-                else i++;
-            }
-            // Jeśli 2 kolejne jednomiany nie mają tego samego wykładnika to i-ty jednomian
-            // z new_monos przepisujemy na j-te miejsce w newer_monos.
-            else {
-                newer_monos[j] = new_monos[i];
-                j++;
-            }
-        }
-        // Skrajne przypadki:
-        // Możliwe jest, że nie przepisaliśmy ostatniego elementu tablicy jednomianów.
-        // Dzieje się tak gdy jego wykładnik jest różny od przedostatniego, nie
-        // wchodzimy wtedy w pętle for dla ostatniego jednomianu. W takim wypadku
-        // wpisujemy go do newer_monos poniżej.
-        if (new_monos[count - 1].exp != new_monos[count - 2].exp) {
-            newer_monos[j] = new_monos[count - 1];
-            j++;
+static Poly PolyBuildMonos(size_t count, Mono *monos) {
+    TraceBegin(TRACE_PHASE, "sort");
+    SortMonos(monos, count);
+    TraceEnd(TRACE_PHASE);
+    TraceBegin(TRACE_PHASE, "merge");
+    size_t size = 0;
+    size_t i = 0;
+    while (i < count) {
+        size_t run_end = i + 1;
+        while (run_end < count && monos[run_end].exp == monos[i].exp) {
+            run_end++;
         }
-        // Jeżeli j jest równe zero, to wszystkie jednomiany się wyzerowały.
-        if (j == 0) {
-            free(new_monos);
-            free(newer_monos);
-            return PolyZero();
+        poly_exp_t exp = monos[i].exp;
+        Poly sum;
+        if (run_end - i == 1) sum = monos[i].p;
+        else sum = PolySumRun(&monos[i], run_end - i);
+        // Zapisujemy zawsze na pozycję nie większą niż i, więc nie nadpisujemy
+        // jednomianów, których jeszcze nie przeczytaliśmy.
+        if (!PolyIsZero(&sum)) {
+            monos[size].p = sum;
+            monos[size].exp = exp;
+            size++;
         }
-        // Jeżeli j == 1 i jedyny jednomian w newer_monos ma wykładnik 0 oraz jego wielomian
-        // jest wspołczynnikiem to chcemy zwrocić wielomian będący tym współczynnikiem.
-        if (j == 1 && newer_monos[0].exp == 0 && PolyIsCoeff(&newer_monos[0].p)) {
-            poly_coeff_t ncoeff = newer_monos[0].p.coeff;
-            free(new_monos);
-            free(newer_monos);
-            return PolyFromCoeff(ncoeff);
-        }
-        free(new_monos);
-        // Na wszelki wypadek usuwamy wszystkie wielomiany,
-        // które mogłyby mieć zerowy wsþółczynnik.
-        for (size_t i = 0; i < j; i++) {
-            PolyRemoveZeros(&newer_monos[i].p);
-        }
-        res.size = j;
-        res.arr = newer_monos;
-        return res;
+        i = run_end;
     }
+    TraceEnd(TRACE_PHASE);
+    if (size > 0 && size < count) {
+        monos = MonosRealloc(monos, size);
+        if (monos == NULL) exit(1);
+    }
+    return PolyFromMonoArray(monos, size);
 }
 
 Poly PolyAddMonos(size_t count, const Mono monos[]) {
@@ -414,76 +514,247 @@ Poly PolyAddMonos(size_t count, const Mono monos[]) {
         return PolyZero();
     }
 
-    Mono *new_monos = malloc(count * sizeof(Mono));
+    Mono *new_monos = MonosAlloc(count);
     if (new_monos == NULL) exit(1);
 
     for (size_t i = 0; i < count; i++) {
         new_monos[i] = monos[i];
     }
-    qsort(new_monos, count, sizeof(Mono), CompareMonosByExp);
-    return PolyFromMonos(count, new_monos);
+    return PolyBuildMonos(count, new_monos);
 }
 
 Poly PolyOwnMonos(size_t count, Mono *monos) {
     if (count == 0 || monos == NULL) {
-        free(monos);
+        MonosFree(monos);
         return PolyZero();
     }
-    qsort(monos, count, sizeof(Mono), CompareMonosByExp);
-    return PolyFromMonos(count, monos);
+    return PolyBuildMonos(count, monos);
 }
 
 Poly PolyCloneMonos(size_t count, const Mono monos[]) {
     if (count == 0 || monos == NULL) {
         return PolyZero();
     }
-    Mono *new_monos = malloc(count * sizeof(Mono));
+    Mono *new_monos = MonosAlloc(count);
     if (new_monos == NULL) exit(1);
 
     for (size_t i = 0; i < count; i++) {
         new_monos[i] = MonoClone(&monos[i]);
     }
-    qsort(new_monos, count, sizeof(Mono), CompareMonosByExp);
-    return PolyFromMonos(count, new_monos);
+    return PolyBuildMonos(count, new_monos);
 }
 
 /**
- * Funkcja pomocniczna do MulArrayAndCoeff
- * kiedy dwie liczby pomnożone przez siebie dają 0 to usuwa
- * jednomian z tego indeksu i przenosi reszte o index do tyłu
+ * To jest struktura przechowująca kursor scalania w PolyAddMany: indeks
+ * wielomianu i wykładnik jednomianu, na który kursor wskazuje.
+ */
+typedef struct Cursor {
+    poly_exp_t exp;     ///< wykładnik wskazywanego jednomianu
+    size_t index;       ///< indeks wielomianu
+} Cursor;
+
+/**
+ * Przesuwa w dół kopca minimalnego kursorów element z pozycji @p k.
  */
-static void ResizePolyAndRemoveMono(Poly *res, size_t index_to_remove) {
-    MonoDestroy(&res->arr[index_to_remove]);
-    for (size_t i = index_to_remove; i < res->size - 1; i++) {
-        res->arr[i] = res->arr[i + 1];
+static void HeapSiftDown(Cursor heap[], size_t size, size_t k) {
+    Cursor item = heap[k];
+    while (2 * k + 1 < size) {
+        size_t child = 2 * k + 1;
+        if (child + 1 < size && heap[child + 1].exp < heap[child].exp) child++;
+        if (heap[child].exp >= item.exp) break;
+        heap[k] = heap[child];
+        k = child;
+    }
+    heap[k] = item;
+}
+
+Poly PolyAddMany(size_t count, const Poly polys[]) {
+    if (count == 0 || polys == NULL) return PolyZero();
+    if (count == 1) return PolyClone(&polys[0]);
+    if (count == 2) return PolyAdd(&polys[0], &polys[1]);
+
+    // Współczynniki sumujemy od razu, a wielomiany scalamy kopcem kursorów.
+    Cursor *heap = malloc(count * sizeof(Cursor));
+    size_t *pos = calloc(count, sizeof(size_t));
+    if (heap == NULL || pos == NULL) exit(1);
+    unsigned long coeff = 0;
+    size_t heap_size = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (PolyIsCoeff(&polys[i])) {
+            coeff += (unsigned long)polys[i].coeff;
+        }
+        else {
+            heap[heap_size].exp = polys[i].arr[0].exp;
+            heap[heap_size].index = i;
+            heap_size++;
+            total += polys[i].size;
+        }
+    }
+    if (heap_size == 0) {
+        free(heap);
+        free(pos);
+        return PolyFromCoeff((poly_coeff_t)coeff);
+    }
+    for (size_t k = heap_size / 2; k-- > 0;) {
+        HeapSiftDown(heap, heap_size, k);
     }
-    res->size -= 1;
+
+    Mono *res = MonosAlloc(total + 1);
+    Poly *group = malloc((heap_size + 1) * sizeof(Poly));
+    if (res == NULL || group == NULL) exit(1);
+    size_t res_size = 0;
+    // Suma współczynników jest jednomianem o wykładniku 0, więc trafia do
+    // pierwszej grupy albo, jeśli ta ma większy wykładnik, przed nią.
+    if (coeff != 0 && heap[0].exp > 0) {
+        res[res_size].p = PolyFromCoeff((poly_coeff_t)coeff);
+        res[res_size].exp = 0;
+        res_size++;
+        coeff = 0;
+    }
+    while (heap_size > 0) {
+        poly_exp_t exp = heap[0].exp;
+        size_t group_size = 0;
+        if (coeff != 0) {
+            group[group_size++] = PolyFromCoeff((poly_coeff_t)coeff);
+            coeff = 0;
+        }
+        // Zdejmujemy z kopca wszystkie jednomiany o wykładniku exp,
+        // przesuwając ich kursory.
+        do {
+            size_t i = heap[0].index;
+            group[group_size++] = polys[i].arr[pos[i]].p;
+            if (++pos[i] < polys[i].size) heap[0].exp = polys[i].arr[pos[i]].exp;
+            else heap[0] = heap[--heap_size];
+            if (heap_size > 0) HeapSiftDown(heap, heap_size, 0);
+        } while (heap_size > 0 && heap[0].exp == exp);
+
+        Poly sum;
+        if (group_size == 1) sum = PolyClone(&group[0]);
+        else sum = PolyAddMany(group_size, group);
+        if (!PolyIsZero(&sum)) {
+            res[res_size].p = sum;
+            res[res_size].exp = exp;
+            res_size++;
+        }
+    }
+    free(heap);
+    free(pos);
+    free(group);
+
+    if (res_size > 0 && res_size < total + 1) {
+        res = MonosRealloc(res, res_size);
+        if (res == NULL) exit(1);
+    }
+    return PolyFromMonoArray(res, res_size);
 }
 
 /**
- * Funkcja mnoży wielomian przez współczynnik
+ * Mnoży dwa współczynniki modulo @f$2^{64}@f$. Mnożenie wykonujemy na liczbach
+ * bez znaku, więc przepełnienie jest dobrze zdefiniowane, a pętle po
+ * współczynnikach mogą być wektoryzowane przez kompilator.
  */
-static Poly PolyMulArrayAndCoeff(const Poly *p, const Poly *q) {
-    poly_coeff_t q_coeff = q->coeff;
-    Poly res = PolyClone(p);
-    for (size_t i = 0; i < res.size; i++) {
-        if (PolyIsCoeff(&res.arr[i].p)) {
-            res.arr[i].p.coeff *= q_coeff;
-            if (res.arr[i].p.coeff == 0) {
-                ResizePolyAndRemoveMono(&res, i);
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b) {
+    return (poly_coeff_t)((unsigned long)a * (unsigned long)b);
+}
+
+/**
+ * Sprawdza, czy wszystkie jednomiany tablicy mają współczynniki będące liczbami.
+ */
+static bool IsLeafArray(const Mono *arr, size_t size) {
+    bool leaf = true;
+    for (size_t i = 0; i < size; i++) {
+        leaf &= arr[i].p.arr == NULL;
+    }
+    return leaf;
+}
+
+/**
+ * Mnoży wielomian przez niezerowy współczynnik c. Wynik zapisuje do tablicy
+ * o rozmiarze p->size, a jednomiany wyzerowane przez przepełnienie usuwa
+ * jednym przejściem na końcu. Tablice liści (same współczynniki) przetwarza
+ * pętlą bez rozgałęzień.
+ */
+static Poly PolyMulByCoeff(const Poly *p, poly_coeff_t c) {
+    if (PolyIsCoeff(p)) return PolyFromCoeff(CoeffMul(p->coeff, c));
+
+    Mono *res = MonosAlloc(p->size);
+    if (res == NULL) exit(1);
+    size_t size = p->size;
+    if (IsLeafArray(p->arr, p->size)) {
+        bool zeros = false;
+        for (size_t i = 0; i < size; i++) {
+            poly_coeff_t coeff = CoeffMul(p->arr[i].p.coeff, c);
+            res[i].p = PolyFromCoeff(coeff);
+            res[i].exp = p->arr[i].exp;
+            zeros |= coeff == 0;
+        }
+        if (zeros) size = RemoveZeroMonos(res, size);
+    }
+    else {
+        size = 0;
+        for (size_t i = 0; i < p->size; i++) {
+            Poly product = PolyMulByCoeff(&p->arr[i].p, c);
+            if (!PolyIsZero(&product)) {
+                res[size].p = product;
+                res[size].exp = p->arr[i].exp;
+                size++;
+            }
+        }
+    }
+    return PolyFromMonoArray(res, size);
+}
+
+void PolyScale(Poly *p, poly_coeff_t c) {
+    assert(p != NULL);
+    if (PolyIsCoeff(p)) {
+        p->coeff = CoeffMul(p->coeff, c);
+    }
+    else if (c == 0) {
+        PolyDestroy(p);
+        *p = PolyZero();
+    }
+    else if (c != 1) {
+        bool zeros = false;
+        if (IsLeafArray(p->arr, p->size)) {
+            for (size_t i = 0; i < p->size; i++) {
+                p->arr[i].p.coeff = CoeffMul(p->arr[i].p.coeff, c);
+                zeros |= p->arr[i].p.coeff == 0;
             }
         }
         else {
-            Poly helper = res.arr[i].p;
-            res.arr[i].p = PolyMul(&res.arr[i].p, q);
-            PolyDestroy(&helper);
+            for (size_t i = 0; i < p->size; i++) {
+                PolyScale(&p->arr[i].p, c);
+                zeros |= PolyIsZero(&p->arr[i].p);
+            }
+        }
+        // Jedyny jednomian o wykładniku 0 mógł stać się współczynnikiem.
+        if (zeros || p->size == 1) {
+            *p = PolyFromMonoArray(p->arr, RemoveZeroMonos(p->arr, p->size));
         }
     }
-    if (res.size == 0) {
-        PolyDestroy(&res);
-        return PolyZero();
+}
+
+/**
+ * Funkcja mnoży wielomian p przez pojedynczy jednomian m. Wykładniki
+ * jednomianów p przesuwamy o wykładnik m, a ich współczynniki mnożymy przez
+ * współczynnik m. Kolejność jednomianów p zostaje zachowana, więc wynik
+ * tworzymy w jednym przejściu, bez sortowania i scalania.
+ */
+static Poly PolyMulByMono(const Poly *p, const Mono *m) {
+    Mono *res = MonosAlloc(p->size);
+    if (res == NULL) exit(1);
+    size_t res_size = 0;
+    for (size_t i = 0; i < p->size; i++) {
+        Poly product = PolyMul(&p->arr[i].p, &m->p);
+        // Iloczyn może się wyzerować tylko przez przepełnienie.
+        if (!PolyIsZero(&product)) {
+            res[res_size].p = product;
+            res[res_size].exp = p->arr[i].exp + m->exp;
+            res_size++;
+        }
     }
-    return res;
+    return PolyFromMonoArray(res, res_size);
 }
 
 Poly PolyMul(const Poly *p, const Poly *q) {
@@ -493,20 +764,28 @@ Poly PolyMul(const Poly *p, const Poly *q) {
     }
     else if (p->arr != NULL && q->arr == NULL) {
         if (q->coeff == 0) return PolyFromCoeff(0);
-        return PolyMulArrayAndCoeff(p, q);
+        return PolyMulByCoeff(p, q->coeff);
     }
     else if (p->arr == NULL && q->arr != NULL) {
         if (p->coeff == 0) return PolyFromCoeff(0);
-        return PolyMulArrayAndCoeff(q, p);
+        return PolyMulByCoeff(q, p->coeff);
+    }
+    else if (q->size == 1) {
+        return PolyMulByMono(p, &q->arr[0]);
+    }
+    else if (p->size == 1) {
+        return PolyMulByMono(q, &p->arr[0]);
     }
     else {
     /*
     * Mnoży każdy wielomian jednomianu z każdym innym i tworzy z nich tablice
-    * na tak stworzonej tablicy wykonuje funkcje PolyAddMonos.
+    * na tak stworzonej tablicy wykonuje funkcje PolyOwnMonos.
     */
         size_t count = p->size * q->size;
         size_t monos_index = 0;
-        Mono *monos = malloc(count * sizeof(Mono));
+        TraceBegin(TRACE_OP, "PolyMul");
+        TraceBegin(TRACE_PHASE, "multiply");
+        Mono *monos = MonosAlloc(count);
         if (monos == NULL) exit(1);
         for (size_t i = 0; i < p->size; i++) {
             for (size_t j = 0; j < q->size; j++) {
@@ -515,25 +794,328 @@ Poly PolyMul(const Poly *p, const Poly *q) {
                 monos_index++;
             }
         }
-        Poly res = PolyAddMonos(count, monos);
-        free(monos);
+        TraceEnd(TRACE_PHASE);
+        Poly res = PolyOwnMonos(count, monos);
+        TraceEnd(TRACE_OP);
         return res;
     }
 }
 
+/**
+ * Zwraca liczbę współczynników liczbowych wielomianu, licząc rekurencyjnie
+ * współczynniki wszystkich jednomianów.
+ */
+static size_t TermsCount(const Poly *p) {
+    if (PolyIsCoeff(p)) return 1;
+    size_t count = 0;
+    for (size_t i = 0; i < p->size; i++) {
+        count += TermsCount(&p->arr[i].p);
+    }
+    return count;
+}
+
+static const Poly *MulTree(const Poly *polys[], size_t count, size_t threads,
+                           Poly *product);
+
+/**
+ * To jest struktura przechowująca poddrzewo iloczynu liczone w osobnym wątku.
+ */
+typedef struct MulTreeTask {
+    const Poly **polys;     ///< mnożone wielomiany
+    size_t count;           ///< liczba mnożonych wielomianów
+    size_t threads;         ///< liczba wątków dostępnych dla poddrzewa
+    StatsScope scope;       ///< statystyki wątku, który zlecił poddrzewo
+    Poly product;           ///< iloczyn więcej niż jednego wielomianu
+    const Poly *result;     ///< iloczyn wielomianów (zob. MulTree)
+} MulTreeTask;
+
+/**
+ * Funkcja wątku liczącego poddrzewo iloczynu.
+ */
+static void *MulTreeWorker(void *arg) {
+    MulTreeTask *task = arg;
+    StatsAttach(task->scope);
+    task->result = MulTree(task->polys, task->count, task->threads, &task->product);
+    return NULL;
+}
+
+/**
+ * Funkcja mnoży @p count > 0 wielomianów, które nie są współczynnikami,
+ * dzieląc je na dwie równe połowy i mnożąc ich iloczyny. Jeśli ma do
+ * dyspozycji więcej niż jeden wątek, a wielomiany są dość duże, lewą
+ * połowę liczy w nowym wątku, dzieląc między połowy pozostałe wątki.
+ * Iloczyn więcej niż jednego wielomianu zapisuje w @p product, a jedynego
+ * wielomianu nie kopiuje.
+ * @return @p product albo jedyny wielomian z @p polys
+ */
+static const Poly *MulTree(const Poly *polys[], size_t count, size_t threads,
+                           Poly *product) {
+    if (count == 1) return polys[0];
+    if (count == 2) {
+        *product = PolyMul(polys[0], polys[1]);
+        return product;
+    }
+
+    size_t half = count / 2;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += polys[i]->size;
+    }
+    Poly left_product, right_product;
+    const Poly *left, *right;
+    if (threads > 1 && total >= MUL_PARALLEL_THRESHOLD) {
+        MulTreeTask task = {.polys = polys, .count = half, .threads = threads / 2,
+                            .scope = StatsCurrent()};
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, MulTreeWorker, &task) != 0) exit(1);
+        right = MulTree(polys + half, count - half, threads - threads / 2,
+                        &right_product);
+        if (pthread_join(thread, NULL) != 0) exit(1);
+        left_product = task.product;
+        left = task.result == &task.product ? &left_product : task.result;
+    }
+    else {
+        left = MulTree(polys, half, 1, &left_product);
+        right = MulTree(polys + half, count - half, 1, &right_product);
+    }
+    *product = PolyMul(left, right);
+    if (left == &left_product) PolyDestroy(&left_product);
+    if (right == &right_product) PolyDestroy(&right_product);
+    return product;
+}
+
+/**
+ * Sprawdza, czy w iloczynie @p product wielomianów @p p i @p q wyraźnie
+ * ubyło współczynników, bo wiele iloczynów jednomianów ma równe wykładniki.
+ * Tak jest dla wielomianów gęstych, których iloczyny rosną wolno i które
+ * taniej mnożyć po kolei niż w drzewie.
+ */
+static bool IsCollapsing(const Poly *product, const Poly *p, const Poly *q) {
+    return TermsCount(product) * MUL_COLLAPSE_DENOMINATOR <
+           TermsCount(p) * TermsCount(q) * MUL_COLLAPSE_NUMERATOR;
+}
+
+/**
+ * Funkcja mnoży po kolei wielomian @p product, przejmowany na własność,
+ * przez @p count wielomianów.
+ */
+static Poly MulChain(Poly product, const Poly *polys[], size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Poly next = PolyMul(&product, polys[i]);
+        PolyDestroy(&product);
+        product = next;
+    }
+    return product;
+}
+
+Poly PolyMulMany(size_t count, const Poly polys[], size_t threads) {
+    if (count == 0 || polys == NULL) return PolyFromCoeff(1);
+    if (count == 1) return PolyClone(&polys[0]);
+    if (count == 2) return PolyMul(&polys[0], &polys[1]);
+
+    // Współczynniki mnożymy od razu, a resztę wielomianów w drzewie albo po kolei.
+    const Poly **factors = malloc(count * sizeof(Poly *));
+    if (factors == NULL) exit(1);
+    unsigned long coeff = 1;
+    size_t factors_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (PolyIsCoeff(&polys[i])) coeff *= (unsigned long)polys[i].coeff;
+        else factors[factors_count++] = &polys[i];
+    }
+
+    Poly product;
+    if (coeff == 0) product = PolyZero();
+    else if (factors_count == 0) product = PolyFromCoeff((poly_coeff_t)coeff);
+    else if (factors_count == 1) product = PolyClone(factors[0]);
+    else if (factors_count == 2) product = PolyMul(factors[0], factors[1]);
+    else {
+        // Iloczyn dwóch pierwszych wielomianów pokazuje, czy drzewo się opłaca.
+        Poly first = PolyMul(factors[0], factors[1]);
+        if (IsCollapsing(&first, factors[0], factors[1])) {
+            product = MulChain(first, factors + 2, factors_count - 2);
+        }
+        else {
+            // Policzony iloczyn jest liściem drzewa w miejscu obu czynników.
+            factors[1] = &first;
+            MulTree(factors + 1, factors_count - 1, threads == 0 ? 1 : threads,
+                    &product);
+            PolyDestroy(&first);
+        }
+    }
+    PolyScale(&product, (poly_coeff_t)coeff);
+    free(factors);
+    return product;
+}
+
+/**
+ * Funkcja pomocnicza do PolyFma, mnoży wielomian p przez mnożnik m.
+ * Jeżeli mnożnik jest równy 1, wykonuje jedynie kopię wielomianu.
+ */
+static Poly PolyMulTerm(const Poly *p, const Poly *m) {
+    if (PolyIsCoeff(m) && m->coeff == 1) return PolyClone(p);
+    else return PolyMul(p, m);
+}
+
+/**
+ * Funkcja pomocnicza do PolyFma. Dodaje do posortowanej tablicy jednomianów
+ * *arr o rozmiarze *size i pojemności *capacity jednomiany z tablicy row
+ * pomnożone przez wielomian m, z wykładnikami zwiększonymi o shift.
+ * Jednomiany scala od końca w miejscu, jednomiany o równych wykładnikach
+ * sumuje rekurencyjnie przez PolyFma, a na koniec jednym przejściem
+ * usuwa powstałe luki i jednomiany zerowe.
+ */
+static void MergeRowInto(Mono **arr, size_t *size, size_t *capacity,
+                         const Mono *row, size_t row_size, const Poly *m, poly_exp_t shift) {
+    size_t total = *size + row_size;
+    if (total > *capacity) {
+        *capacity = total > 2 * *capacity ? total : 2 * *capacity;
+        *arr = MonosRealloc(*arr, *capacity);
+        if (*arr == NULL) exit(1);
+    }
+    Mono *res = *arr;
+    size_t a = *size;
+    size_t b = row_size;
+    size_t w = total;
+    while (b > 0) {
+        poly_exp_t exp = row[b - 1].exp + shift;
+        if (a > 0 && res[a - 1].exp > exp) {
+            res[--w] = res[--a];
+        }
+        else if (a > 0 && res[a - 1].exp == exp) {
+            Mono mono = res[--a];
+            PolyFma(&mono.p, &row[b - 1].p, m);
+            res[--w] = mono;
+            b--;
+        }
+        else {
+            res[--w].p = PolyMulTerm(&row[b - 1].p, m);
+            res[w].exp = exp;
+            b--;
+        }
+    }
+    // Jednomiany res[0..a) zostały na swoich miejscach, przesuwamy za nie
+    // scalone jednomiany, pomijając te, które się wyzerowały.
+    size_t j = a;
+    for (size_t i = w; i < total; i++) {
+        if (!PolyIsZero(&res[i].p)) {
+            res[j++] = res[i];
+        }
+    }
+    *size = j;
+}
+
+void PolyFma(Poly *acc, const Poly *p, const Poly *q) {
+    assert(acc != NULL && p != NULL && q != NULL);
+    assert(acc != p && acc != q);
+    if (PolyIsZero(p) || PolyIsZero(q)) return;
+    if (PolyIsCoeff(p) && PolyIsCoeff(q) && PolyIsCoeff(acc)) {
+        acc->coeff += p->coeff * q->coeff;
+        return;
+    }
+
+    // Wielomian acc traktujemy jako tablicę jednomianów (być może pustą,
+    // lub złożoną z jednego jednomianu będącego współczynnikiem).
+    Mono *arr;
+    size_t size;
+    size_t capacity;
+    if (PolyIsCoeff(acc)) {
+        capacity = INITIAL_ARR_SIZE;
+        arr = MonosAlloc(capacity);
+        if (arr == NULL) exit(1);
+        size = 0;
+        if (acc->coeff != 0) {
+            arr[0].p = PolyFromCoeff(acc->coeff);
+            arr[0].exp = 0;
+            size = 1;
+        }
+    }
+    else {
+        arr = acc->arr;
+        size = acc->size;
+        capacity = acc->size;
+    }
+
+    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
+        Mono row = {.p = PolyFromCoeff(p->coeff * q->coeff), .exp = 0};
+        Poly one = PolyFromCoeff(1);
+        MergeRowInto(&arr, &size, &capacity, &row, 1, &one, 0);
+    }
+    else if (PolyIsCoeff(q)) {
+        MergeRowInto(&arr, &size, &capacity, p->arr, p->size, q, 0);
+    }
+    else if (PolyIsCoeff(p)) {
+        MergeRowInto(&arr, &size, &capacity, q->arr, q->size, p, 0);
+    }
+    else {
+        for (size_t i = 0; i < p->size; i++) {
+            MergeRowInto(&arr, &size, &capacity, q->arr, q->size,
+                         &p->arr[i].p, p->arr[i].exp);
+        }
+    }
+
+    *acc = PolyFromMonoArray(arr, size);
+}
+
 Poly PolyNeg(const Poly *p) {
     assert(p != NULL);
-    Poly neg = PolyFromCoeff(-1);
-    Poly res = PolyMul(p, &neg);
-    return res;
+    return PolyMulByCoeff(p, -1);
+}
+
+/**
+ * Funkcja pomocnicza do PolySub. Ustawia tablicę jednomianów wielomianu @p p;
+ * współczynnik różny od zera traktuje jak jednomian o wykładniku 0, który
+ * zapisuje w @p coeff_mono.
+ */
+static void MonosOf(const Poly *p, Mono *coeff_mono, const Mono **arr, size_t *size) {
+    if (!PolyIsCoeff(p)) {
+        *arr = p->arr;
+        *size = p->size;
+    }
+    else {
+        *coeff_mono = (Mono) {.p = *p, .exp = 0};
+        *arr = coeff_mono;
+        *size = PolyIsZero(p) ? 0 : 1;
+    }
 }
 
 Poly PolySub(const Poly *p, const Poly *q) {
     assert(p != NULL && q != NULL);
-    Poly q_neg = PolyNeg(q);
-    Poly res = PolyAdd(p, &q_neg);
-    PolyDestroy(&q_neg);
-    return res;
+    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
+        return PolyFromCoeff((poly_coeff_t)((unsigned long)p->coeff -
+                                            (unsigned long)q->coeff));
+    }
+    // Scalamy tablice jednomianów jednym przejściem, negując jednomiany q
+    // od razu przy kopiowaniu, bez tworzenia wielomianu przeciwnego do q.
+    Mono p_coeff, q_coeff;
+    const Mono *p_arr, *q_arr;
+    size_t p_size, q_size;
+    MonosOf(p, &p_coeff, &p_arr, &p_size);
+    MonosOf(q, &q_coeff, &q_arr, &q_size);
+    Mono *res = MonosAlloc(p_size + q_size);
+    if (res == NULL) exit(1);
+    size_t i = 0, j = 0, size = 0;
+    while (i < p_size || j < q_size) {
+        if (j == q_size || (i < p_size && p_arr[i].exp < q_arr[j].exp)) {
+            res[size++] = MonoClone(&p_arr[i++]);
+        }
+        else if (i == p_size || q_arr[j].exp < p_arr[i].exp) {
+            res[size].p = PolyNeg(&q_arr[j].p);
+            res[size].exp = q_arr[j].exp;
+            size++;
+            j++;
+        }
+        else {
+            Poly difference = PolySub(&p_arr[i].p, &q_arr[j].p);
+            if (!PolyIsZero(&difference)) {
+                res[size].p = difference;
+                res[size].exp = p_arr[i].exp;
+                size++;
+            }
+            i++;
+            j++;
+        }
+    }
+    return PolyFromMonoArray(res, size);
 }
 
 poly_exp_t PolyDegBy(const Poly *p, size_t var_idx) {
@@ -656,23 +1238,41 @@ Poly PolyAt(const Poly *p, poly_coeff_t x) {
         for (size_t i = 0; i < p->size; i++) {
             poly_coeff_t x_power_exp = Power(x, p->arr[i].exp); // x^exp
             Poly x_power_exp_poly = PolyFromCoeff(x_power_exp); // C(x^exp)
-            // Mnożymy x^exp przez wielomian, który był w
+            // Dodajemy do wyniku iloczyn x^exp i wielomianu, który był w
             // tablicy jednomianów na i-tym miejscu.
-            Poly multiplier = PolyMul(&x_power_exp_poly, &p->arr[i].p);
-            PolyDestroy(&x_power_exp_poly);
-            Poly helper = res;
-            res = PolyAdd(&helper, &multiplier);
-            PolyDestroy(&helper);
-            PolyDestroy(&multiplier);
+            PolyFma(&res, &x_power_exp_poly, &p->arr[i].p);
         }
         return res;
     }
 }
 
+Poly PolySquare(const Poly *p) {
+    assert(p != NULL);
+    if (PolyIsCoeff(p)) return PolyFromCoeff(CoeffMul(p->coeff, p->coeff));
+    // Iloczyny jednomianów i, j oraz j, i są równe, więc liczymy je raz
+    // i podwajamy, a kwadraty jednomianów liczymy rekurencyjnie.
+    size_t count = p->size * (p->size + 1) / 2;
+    Mono *monos = MonosAlloc(count);
+    if (monos == NULL) exit(1);
+    size_t k = 0;
+    for (size_t i = 0; i < p->size; i++) {
+        monos[k].p = PolySquare(&p->arr[i].p);
+        monos[k].exp = 2 * p->arr[i].exp;
+        k++;
+        for (size_t j = i + 1; j < p->size; j++) {
+            monos[k].p = PolyMul(&p->arr[i].p, &p->arr[j].p);
+            PolyScale(&monos[k].p, 2);
+            monos[k].exp = p->arr[i].exp + p->arr[j].exp;
+            k++;
+        }
+    }
+    return PolyOwnMonos(count, monos);
+}
+
 /**
  * Podnosi wielomian do potęgi power, korzystając z szybkiego potęgowania.
  */
-static Poly PolyPower(const Poly *p, poly_exp_t power) {
+static Poly PolyPowBySquaring(const Poly *p, poly_exp_t power) {
     Poly result = PolyFromCoeff(1);
     Poly multiplier = PolyClone(p);
     Poly new_result;
@@ -684,16 +1284,191 @@ static Poly PolyPower(const Poly *p, poly_exp_t power) {
             PolyDestroy(&result);
             result = new_result;
         }
-
-        new_multiplier = PolyMul(&multiplier, &multiplier);
-        PolyDestroy(&multiplier);
-        multiplier = new_multiplier;
         power /= 2;
+        // Ostatniego kwadratu nie będziemy już potrzebować.
+        if (power > 0) {
+            new_multiplier = PolySquare(&multiplier);
+            PolyDestroy(&multiplier);
+            multiplier = new_multiplier;
+        }
     }
     PolyDestroy(&multiplier);
     return result;
 }
 
+/**
+ * Zwraca liczbę składników rozwinięcia wielomianowego (size jednomianów
+ * podniesionych do potęgi power), czyli @f$\binom{power + size - 1}{size - 1}@f$.
+ * Jeżeli liczba ta przekracza MULTINOMIAL_MAX_TERMS, zwraca MULTINOMIAL_MAX_TERMS + 1.
+ */
+static size_t MultinomialTermsCount(size_t size, poly_exp_t power) {
+    size_t count = 1;
+    for (size_t i = 1; i < size; i++) {
+        // Iloczyn kolejnych liczb jest podzielny przez i!, więc dzielenie jest dokładne.
+        count = count * ((size_t)power + i) / i;
+        if (count > MULTINOMIAL_MAX_TERMS) return MULTINOMIAL_MAX_TERMS + 1;
+    }
+    return count;
+}
+
+/**
+ * Struktura przechowująca dane wspólne dla wszystkich wywołań MultinomialTerms.
+ */
+typedef struct MultinomialData {
+    const Poly *base; ///< potęgowany wielomian
+    Poly **powers; ///< powers[i][k] to współczynnik i-tego jednomianu podstawy do potęgi k
+    unsigned long **binomials; ///< trójkąt Pascala, binomials[n][k] to @f$\binom{n}{k}@f$
+    Mono *monos; ///< tablica tworzonych składników rozwinięcia
+    size_t monos_count; ///< liczba składników zapisanych w tablicy monos
+} MultinomialData;
+
+/**
+ * Rekurencyjnie przegląda wszystkie rozkłady wykładnika remaining na jednomiany
+ * podstawy o indeksach od idx w górę. Dla każdego rozkładu dopisuje do tablicy
+ * data->monos składnik rozwinięcia wielomianowego. Parametr acc to iloczyn potęg
+ * współczynników jednomianów o indeksach mniejszych niż idx, multinomial to
+ * dotychczasowy współczynnik wielomianowy, a exp to dotychczasowy wykładnik.
+ */
+static void MultinomialTerms(MultinomialData *data, size_t idx, poly_exp_t remaining,
+                             const Poly *acc, unsigned long multinomial, poly_exp_t exp) {
+    const Mono *mono = &data->base->arr[idx];
+    bool last = idx == data->base->size - 1;
+    // Ostatni jednomian musi przejąć cały pozostały wykładnik.
+    for (poly_exp_t k = last ? remaining : 0; k <= remaining; k++) {
+        unsigned long new_multinomial = multinomial * data->binomials[remaining][k];
+        // PolyPowFits gwarantuje, że wykładnik mieści się w typie poly_exp_t.
+        assert(k == 0 || mono->exp <= (INT_MAX - exp) / k);
+        poly_exp_t new_exp = exp + k * mono->exp;
+        Poly new_acc;
+        const Poly *power = &data->powers[idx][k];
+        if (PolyIsCoeff(power) && power->coeff == 1) {
+            new_acc = PolyClone(acc);
+        }
+        else {
+            new_acc = PolyMul(acc, power);
+        }
+
+        if (last) {
+            PolyScale(&new_acc, (poly_coeff_t)new_multinomial);
+            if (!PolyIsZero(&new_acc)) {
+                data->monos[data->monos_count].p = new_acc;
+                data->monos[data->monos_count].exp = new_exp;
+                data->monos_count++;
+            }
+        }
+        else {
+            MultinomialTerms(data, idx + 1, remaining - k, &new_acc,
+                             new_multinomial, new_exp);
+            PolyDestroy(&new_acc);
+        }
+    }
+}
+
+/**
+ * Podnosi wielomian o niewielkiej liczbie jednomianów do potęgi power, korzystając
+ * z rozwinięcia wielomianowego @f$(\sum_i a_i x^{e_i})^n = \sum \binom{n}{k_1, \ldots, k_m}
+ * \prod_i a_i^{k_i} x^{k_i e_i}@f$. Potęgi współczynników liczone są przyrostowo,
+ * więc mnożymy zawsze duży wielomian przez mały, zamiast podnosić do kwadratu
+ * coraz większe wielomiany.
+ */
+static Poly PolyPowMultinomial(const Poly *p, poly_exp_t power, size_t terms_count) {
+    MultinomialData data;
+    data.base = p;
+
+    data.binomials = malloc((power + 1) * sizeof(unsigned long *));
+    if (data.binomials == NULL) exit(1);
+    for (poly_exp_t n = 0; n <= power; n++) {
+        data.binomials[n] = malloc((n + 1) * sizeof(unsigned long));
+        if (data.binomials[n] == NULL) exit(1);
+        data.binomials[n][0] = 1;
+        data.binomials[n][n] = 1;
+        for (poly_exp_t k = 1; k < n; k++) {
+            data.binomials[n][k] = data.binomials[n - 1][k - 1] + data.binomials[n - 1][k];
+        }
+    }
+
+    data.powers = malloc(p->size * sizeof(Poly *));
+    if (data.powers == NULL) exit(1);
+    for (size_t i = 0; i < p->size; i++) {
+        data.powers[i] = malloc((power + 1) * sizeof(Poly));
+        if (data.powers[i] == NULL) exit(1);
+        data.powers[i][0] = PolyFromCoeff(1);
+        for (poly_exp_t k = 1; k <= power; k++) {
+            data.powers[i][k] = PolyMul(&data.powers[i][k - 1], &p->arr[i].p);
+        }
+    }
+
+    data.monos = MonosAlloc(terms_count);
+    if (data.monos == NULL) exit(1);
+    data.monos_count = 0;
+    Poly one = PolyFromCoeff(1);
+    MultinomialTerms(&data, 0, power, &one, 1, 0);
+
+    for (size_t i = 0; i < p->size; i++) {
+        for (poly_exp_t k = 0; k <= power; k++) {
+            PolyDestroy(&data.powers[i][k]);
+        }
+        free(data.powers[i]);
+    }
+    free(data.powers);
+    for (poly_exp_t n = 0; n <= power; n++) {
+        free(data.binomials[n]);
+    }
+    free(data.binomials);
+
+    return PolyOwnMonos(data.monos_count, data.monos);
+}
+
+bool PolyPowFits(const Poly *p, poly_exp_t n) {
+    assert(p != NULL && n >= 0);
+    if (PolyIsCoeff(p) || n <= 1) return true;
+    for (size_t i = 0; i < p->size; i++) {
+        if (p->arr[i].exp > INT_MAX / n || !PolyPowFits(&p->arr[i].p, n)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Poly PolyPow(const Poly *p, poly_exp_t power) {
+    assert(p != NULL && power >= 0);
+    if (PolyIsCoeff(p)) {
+        return PolyFromCoeff(Power(p->coeff, power));
+    }
+    else if (power == 0) {
+        return PolyFromCoeff(1);
+    }
+    else if (power == 1) {
+        return PolyClone(p);
+    }
+    else if (p->size == 1) {
+        // (a * x^e)^n = a^n * x^(e * n), potęgujemy tylko współczynnik.
+        Poly coeff_power = PolyPow(&p->arr[0].p, power);
+        if (PolyIsZero(&coeff_power) ||
+            (PolyIsCoeff(&coeff_power) && p->arr[0].exp == 0)) {
+            return coeff_power;
+        }
+        Poly result;
+        result.size = 1;
+        result.arr = MonosAlloc(1);
+        if (result.arr == NULL) exit(1);
+        result.arr[0].p = coeff_power;
+        assert(p->arr[0].exp <= INT_MAX / power);
+        result.arr[0].exp = p->arr[0].exp * power;
+        return result;
+    }
+    else {
+        size_t terms_count = MultinomialTermsCount(p->size, power);
+        if (p->size <= MULTINOMIAL_MAX_SIZE && power <= MULTINOMIAL_MAX_EXP &&
+            terms_count <= MULTINOMIAL_MAX_TERMS) {
+            return PolyPowMultinomial(p, power, terms_count);
+        }
+        else {
+            return PolyPowBySquaring(p, power);
+        }
+    }
+}
+
 /**
  * Funkcja zakłada, że wszystkie zmienne wielomianu są równe 0.
  * Sumuje te współczynniki, przy którychw ykładnik jest równy zero.
@@ -718,25 +1493,26 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
     }
     else {
         if (k > 0) {
-            Poly new_result;
             Poly result = PolyZero();
             Poly composed_coeff;
-            Poly composed_poly;
+            TraceBegin(TRACE_OP, "PolyCompose");
             for (size_t j = 0; j < p->size; j++) {
                 // q^exp. Podnosimy nasz wielomian do wykładnika jednomianu.
-                Poly power_poly = PolyPower(q, p->arr[j].exp);
+                TraceBegin(TRACE_PHASE, "power");
+                Poly power_poly = PolyPow(q, p->arr[j].exp);
+                TraceEnd(TRACE_PHASE);
                 // Składamy współczynnik wielomianu (czyli wielomian jednomianu).
+                TraceBegin(TRACE_PHASE, "compose");
                 composed_coeff = PolyCompose(&(p->arr[j].p), k - 1, q + 1);
-                // Mnożymy otrzymany wielomian przez wielomian jednomianu.
-                composed_poly = PolyMul(&power_poly, &composed_coeff);
+                TraceEnd(TRACE_PHASE);
+                // Dodajemy do całego wyniku iloczyn otrzymanych wyżej wielomianów.
+                TraceBegin(TRACE_PHASE, "multiply");
+                PolyFma(&result, &power_poly, &composed_coeff);
+                TraceEnd(TRACE_PHASE);
                 PolyDestroy(&composed_coeff);
-                // Dodajemy do całego wyniku otrzymany wyżej wielomian.
-                new_result = PolyAdd(&result, &composed_poly);
-                PolyDestroy(&result);
-                result = new_result;
                 PolyDestroy(&power_poly);
-                PolyDestroy(&composed_poly);
             }
+            TraceEnd(TRACE_OP);
             return result;
         }
         else {
@@ -746,3 +1522,255 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
     }
 }
 
+/**
+ * Zapewnia w buforze miejsce na co najmniej @p count kolejnych znaków.
+ * Bufor rośnie geometrycznie, więc dopisywanie ma zamortyzowany koszt stały.
+ */
+static void BufferReserve(PolyBuffer *buffer, size_t count) {
+    if (buffer->size + count > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? FORMAT_INITIAL_SIZE : buffer->capacity;
+        while (capacity < buffer->size + count) capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        if (buffer->data == NULL) exit(1);
+        buffer->capacity = capacity;
+    }
+}
+
+/**
+ * Dopisuje do bufora jeden znak.
+ */
+static inline void BufferAppendChar(PolyBuffer *buffer, char c) {
+    BufferReserve(buffer, 1);
+    buffer->data[buffer->size++] = c;
+}
+
+/**
+ * Dopisuje do bufora liczbę w zapisie dziesiętnym. Cyfry wyznaczamy od końca
+ * na wartości bezwzględnej bez znaku, dzięki czemu poprawnie obsługujemy
+ * LONG_MIN.
+ */
+static void BufferAppendLong(PolyBuffer *buffer, long value) {
+    char digits[LONG_MAX_DIGITS];
+    unsigned long magnitude = value < 0 ? 0 - (unsigned long)value : (unsigned long)value;
+    size_t count = 0;
+    do {
+        digits[count++] = ASCII_ZERO + magnitude % DECIMAL_BASE;
+        magnitude /= DECIMAL_BASE;
+    } while (magnitude > 0);
+
+    BufferReserve(buffer, count + 1);
+    if (value < 0) buffer->data[buffer->size++] = '-';
+    while (count > 0) buffer->data[buffer->size++] = digits[--count];
+}
+
+void PolyFormat(const Poly *p, PolyBuffer *buffer) {
+    if (PolyIsCoeff(p)) {
+        BufferAppendLong(buffer, p->coeff);
+        return;
+    }
+    for (size_t i = 0; i < p->size; i++) {
+        if (i > 0) BufferAppendChar(buffer, '+');
+        BufferAppendChar(buffer, '(');
+        PolyFormat(&p->arr[i].p, buffer);
+        BufferAppendChar(buffer, ',');
+        BufferAppendLong(buffer, p->arr[i].exp);
+        BufferAppendChar(buffer, ')');
+    }
+}
+
+void PolyPrint(const Poly *p) {
+    PolyBuffer buffer = {.data = NULL, .size = 0, .capacity = 0};
+    PolyFormat(p, &buffer);
+    fwrite(buffer.data, 1, buffer.size, stdout);
+    free(buffer.data);
+}
+
+/**
+ * Dopisuje do bufora liczbę bez znaku w kodowaniu o zmiennej długości:
+ * po 7 bitów na bajt, najstarszy bit oznacza, że liczba ma kolejny bajt.
+ */
+static void BufferAppendVarint(PolyBuffer *buffer, unsigned long value) {
+    BufferReserve(buffer, VARINT_MAX_SIZE);
+    while (value > VARINT_MASK) {
+        buffer->data[buffer->size++] = (char)((value & VARINT_MASK) | VARINT_MORE);
+        value >>= VARINT_BITS;
+    }
+    buffer->data[buffer->size++] = (char)value;
+}
+
+/**
+ * Zapisuje w miejscu @p dest liczbę 64-bitową w kolejności little-endian.
+ */
+static void StoreU64(char *dest, unsigned long value) {
+    for (size_t i = 0; i < SERIAL_U64_SIZE; i++) {
+        dest[i] = (char)(value & BYTE_MASK);
+        value >>= BYTE_BITS;
+    }
+}
+
+/**
+ * Odczytuje liczbę 64-bitową zapisaną przez StoreU64.
+ */
+static unsigned long LoadU64(const char *src) {
+    unsigned long value = 0;
+    for (size_t i = SERIAL_U64_SIZE; i > 0; i--) {
+        value = (value << BYTE_BITS) | (unsigned char)src[i - 1];
+    }
+    return value;
+}
+
+/**
+ * Liczy skrót FNV-1a danych, którego używamy jako sumy kontrolnej.
+ */
+static unsigned long Checksum(const char *data, size_t size) {
+    unsigned long hash = FNV_OFFSET;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Dopisuje do bufora drzewo wielomianu. Wielomian stały zapisujemy jako 0
+ * i współczynnik w kodowaniu zygzakowatym, a pozostałe jako liczbę
+ * jednomianów, po której dla każdego jednomianu następuje przyrost wykładnika
+ * względem poprzedniego (pomniejszony o 1) i drzewo współczynnika.
+ */
+static void SerializeNode(const Poly *p, PolyBuffer *buffer) {
+    if (PolyIsCoeff(p)) {
+        unsigned long coeff = (unsigned long)p->coeff;
+        BufferAppendVarint(buffer, 0);
+        BufferAppendVarint(buffer, (coeff << 1) ^ (0 - (coeff >> 63)));
+        return;
+    }
+    BufferAppendVarint(buffer, p->size);
+    // Jak przy odczycie liczymy w typie long, bo różnica dla pierwszego
+    // wykładnika INT_MAX nie mieści się w int.
+    long previous = -1;
+    for (size_t i = 0; i < p->size; i++) {
+        BufferAppendVarint(buffer, (unsigned long)(p->arr[i].exp - previous - 1));
+        previous = p->arr[i].exp;
+        SerializeNode(&p->arr[i].p, buffer);
+    }
+}
+
+void PolySerialize(const Poly *p, PolyBuffer *buffer) {
+    size_t start = buffer->size;
+    BufferReserve(buffer, SERIAL_HEADER_SIZE);
+    memcpy(buffer->data + buffer->size, SERIAL_MAGIC, SERIAL_MAGIC_SIZE);
+    buffer->size += SERIAL_MAGIC_SIZE;
+    buffer->data[buffer->size++] = SERIAL_VERSION;
+    buffer->size += SERIAL_U64_SIZE;
+
+    SerializeNode(p, buffer);
+    StoreU64(buffer->data + start + SERIAL_MAGIC_SIZE + 1,
+             buffer->size - start - SERIAL_HEADER_SIZE);
+
+    unsigned long checksum = Checksum(buffer->data + start, buffer->size - start);
+    BufferReserve(buffer, SERIAL_U64_SIZE);
+    StoreU64(buffer->data + buffer->size, checksum);
+    buffer->size += SERIAL_U64_SIZE;
+}
+
+/**
+ * To jest struktura przechowująca pozycję odczytu drzewa wielomianu.
+ */
+typedef struct SerialReader {
+    const unsigned char *pos; ///< następny bajt do odczytania
+    const unsigned char *end; ///< koniec drzewa
+} SerialReader;
+
+/**
+ * Odczytuje liczbę zapisaną przez BufferAppendVarint.
+ */
+static bool ReadVarint(SerialReader *r, unsigned long *value) {
+    unsigned long result = 0;
+    for (size_t i = 0; i < VARINT_MAX_SIZE && r->pos < r->end; i++) {
+        unsigned char byte = *r->pos++;
+        result |= (unsigned long)(byte & VARINT_MASK) << (VARINT_BITS * i);
+        if ((byte & VARINT_MORE) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Odczytuje drzewo wielomianu zapisane przez SerializeNode na głębokości
+ * @p depth. Odrzuca wielomiany, które nie są w postaci kanonicznej, i drzewa
+ * głębsze niż SERIAL_MAX_DEPTH, żeby rekurencja na niezaufanych danych nie
+ * przepełniła stosu.
+ */
+static bool DeserializeNode(SerialReader *r, Poly *p, size_t depth) {
+    unsigned long size;
+    if (!ReadVarint(r, &size)) return false;
+    if (size == 0) {
+        unsigned long coeff;
+        if (!ReadVarint(r, &coeff)) return false;
+        *p = PolyFromCoeff((poly_coeff_t)((coeff >> 1) ^ (0 - (coeff & 1))));
+        return true;
+    }
+    // Każdy jednomian zajmuje co najmniej 3 bajty, więc nie zaufamy
+    // rozmiarowi, który nie zmieściłby się w pozostałych danych.
+    if (size > (size_t)(r->end - r->pos) / 3) return false;
+    if (depth >= SERIAL_MAX_DEPTH) return false;
+
+    Mono *arr = MonosAlloc(size);
+    if (arr == NULL) exit(1);
+    long exp = -1;
+    size_t i = 0;
+    bool correct = true;
+    while (correct && i < size) {
+        unsigned long delta;
+        correct = ReadVarint(r, &delta) && delta <= INT_MAX &&
+                  exp + 1 + (long)delta <= INT_MAX;
+        if (correct) {
+            exp += (long)delta + 1;
+            arr[i].exp = (poly_exp_t)exp;
+            correct = DeserializeNode(r, &arr[i].p, depth + 1);
+            if (correct && PolyIsZero(&arr[i].p)) {
+                PolyDestroy(&arr[i].p);
+                correct = false;
+            }
+            if (correct) i++;
+        }
+    }
+    if (correct && size == 1 && arr[0].exp == 0 && PolyIsCoeff(&arr[0].p)) {
+        correct = false;
+    }
+    if (!correct) {
+        for (size_t j = 0; j < i; j++) MonoDestroy(&arr[j]);
+        MonosFree(arr);
+        return false;
+    }
+    *p = (Poly) {.size = size, .arr = arr};
+    return true;
+}
+
+size_t PolyDeserialize(const char *data, size_t size, Poly *p) {
+    if (size < SERIAL_HEADER_SIZE + SERIAL_U64_SIZE ||
+        memcmp(data, SERIAL_MAGIC, SERIAL_MAGIC_SIZE) != 0 ||
+        data[SERIAL_MAGIC_SIZE] != SERIAL_VERSION) {
+        return 0;
+    }
+    unsigned long tree_size = LoadU64(data + SERIAL_MAGIC_SIZE + 1);
+    if (tree_size > size - SERIAL_HEADER_SIZE - SERIAL_U64_SIZE) return 0;
+
+    size_t record_size = SERIAL_HEADER_SIZE + tree_size;
+    if (Checksum(data, record_size) != LoadU64(data + record_size)) return 0;
+
+    SerialReader reader = {
+        .pos = (const unsigned char *)data + SERIAL_HEADER_SIZE,
+        .end = (const unsigned char *)data + record_size
+    };
+    Poly result;
+    if (!DeserializeNode(&reader, &result, 0)) return 0;
+    if (reader.pos != reader.end) {
+        PolyDestroy(&result);
+        return 0;
+    }
+    *p = result;
+    return record_size + SERIAL_U64_SIZE;
+}
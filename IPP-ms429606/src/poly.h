@@ -1,6 +1,10 @@
 /** @file
   Interfejs klasy wielomianów rzadkich wielu zmiennych
 
+  Funkcje biblioteki nie używają zmiennych globalnych ani statycznych,
+  więc można je wywoływać jednocześnie z wielu wątków, o ile żaden wielomian
+  nie jest zmieniany w jednym wątku i jednocześnie używany w innym.
+
   @authors Jakub Pawlewicz <pan@mimuw.edu.pl>, Marcin Peczarski <marpe@mimuw.edu.pl>
   @copyright Uniwersytet Warszawski
   @date 2021
@@ -148,6 +152,17 @@ static inline Mono MonoClone(const Mono *m) {
  */
 Poly PolyAdd(const Poly *p, const Poly *q);
 
+/**
+ * Dodaje wiele wielomianów naraz. Jednomiany wszystkich wielomianów scala
+ * jednym przejściem przy pomocy kopca, a współczynniki jednomianów o równych
+ * wykładnikach sumuje rekurencyjnie, więc każdy jednomian jest kopiowany
+ * co najwyżej raz na każdym poziomie.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @return suma wielomianów
+ */
+Poly PolyAddMany(size_t count, const Poly polys[]);
+
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian.
  * Przejmuje na własność zawartość tablicy @p monos.
@@ -161,7 +176,8 @@ Poly PolyAddMonos(size_t count, const Mono monos[]);
  * Sumuje listę jednomianów i tworzy z nich wielomian. Przejmuje na własność
  * pamięć wskazywaną przez @p monos i jej zawartość. Może dowolnie modyfikować
  * zawartość tej pamięci. Zakładamy, że pamięć wskazywana przez @p monos
- * została zaalokowana na stercie. Jeśli @p count lub @p monos jest równe zeru
+ * została zaalokowana na stercie przez MonosAlloc (zob. stats.h) lub, gdy
+ * statystyki nie są zbierane, przez malloc. Jeśli @p count lub @p monos jest równe zeru
  * (NULL), tworzy wielomian tożsamościowo równy zeru.
  * @param[in] count : liczba jednomianów
  * @param[in] monos : tablica jednomianów
@@ -188,6 +204,47 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]);
  */
 Poly PolyMul(const Poly *p, const Poly *q);
 
+/**
+ * Mnoży wiele wielomianów naraz. Wielomiany mnoży parami w zrównoważonym
+ * drzewie, więc duże iloczyny powstają dopiero w ostatnich mnożeniach,
+ * a nie w każdym kroku, jak przy mnożeniu po kolei. Poddrzewa dużych
+ * iloczynów mogą być liczone równolegle w osobnych wątkach.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : tablica wielomianów
+ * @param[in] threads : maksymalna liczba wątków (1 oznacza bez nowych wątków)
+ * @return iloczyn wielomianów (@f$1@f$ dla pustej tablicy)
+ */
+Poly PolyMulMany(size_t count, const Poly polys[], size_t threads);
+
+/**
+ * Podnosi wielomian do kwadratu. Iloczyn każdej pary różnych jednomianów
+ * liczy tylko raz i podwaja, więc mnoży o połowę mniej jednomianów niż
+ * PolyMul(p, p).
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$p^2@f$
+ */
+Poly PolySquare(const Poly *p);
+
+/**
+ * Mnoży w miejscu wielomian przez współczynnik. Przejmuje na własność
+ * zawartość struktury wskazywanej przez @p p i zastępuje ją wynikiem,
+ * nie tworząc kopii wielomianu.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] c : współczynnik @f$c@f$
+ */
+void PolyScale(Poly *p, poly_coeff_t c);
+
+/**
+ * Dodaje w miejscu iloczyn dwóch wielomianów do wielomianu @p acc.
+ * Jednomiany iloczynu są scalane bezpośrednio z tablicą jednomianów @p acc,
+ * bez tworzenia tymczasowego wielomianu @f$p * q@f$.
+ * Wielomian @p acc nie może być tym samym wielomianem co @p p lub @p q.
+ * @param[in,out] acc : wielomian @f$a@f$
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ */
+void PolyFma(Poly *acc, const Poly *p, const Poly *q);
+
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian @f$p@f$
@@ -243,6 +300,27 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  */
 Poly PolyAt(const Poly *p, poly_coeff_t x);
 
+/**
+ * Sprawdza, czy wykładniki wielomianu @p p podniesionego do potęgi @p n
+ * mieszczą się w typie poly_exp_t, czyli czy żaden wykładnik @p p
+ * pomnożony przez @p n nie przekracza INT_MAX.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : wykładnik @f$n \geq 0@f$
+ * @return czy można policzyć @f$p^n@f$ przez PolyPow
+ */
+bool PolyPowFits(const Poly *p, poly_exp_t n);
+
+/**
+ * Podnosi wielomian do potęgi @p n. Dla wielomianów o niewielkiej liczbie
+ * jednomianów korzysta z rozwinięcia wielomianowego, w pozostałych przypadkach
+ * z szybkiego potęgowania. Wykładniki wyniku muszą się mieścić w typie
+ * poly_exp_t (zob. PolyPowFits).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : wykładnik @f$n \geq 0@f$
+ * @return @f$p^n@f$
+ */
+Poly PolyPow(const Poly *p, poly_exp_t n);
+
 /**
  * Funkcja wykonująca składanie wielomianów. Dany jest wielomian p oraz k
  * wielomianów q_0, q_1, q_2, …, q_k−1. Niech l oznacza liczbę zmiennych wielomianu p
@@ -260,15 +338,55 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]);
 void PolyPrint(const Poly *p);
 
 /**
- * Funkcja zakłada, że linia zawiera poprawnie opisany wielomian.
- * Tworzy wielomian z ciągu znaków.
+ * To jest struktura przechowująca bufor znaków o zmiennym rozmiarze.
+ * Pusty bufor to `{NULL, 0, 0}`. Znaki nie są zakończone zerem,
+ * a pamięć zwalnia właściciel bufora.
+ */
+typedef struct PolyBuffer {
+  char *data; ///< zapisane znaki
+  size_t size; ///< liczba zapisanych znaków
+  size_t capacity; ///< rozmiar zaalokowanej pamięci
+} PolyBuffer;
+
+/**
+ * Dopisuje na koniec bufora tekstową postać wielomianu, taką samą, jaką
+ * wypisuje PolyPrint. W razie potrzeby powiększa bufor.
+ * @param[in] p : wielomian
+ * @param[in,out] buffer : bufor
+ */
+void PolyFormat(const Poly *p, PolyBuffer *buffer);
+
+/**
+ * Dopisuje na koniec bufora binarną postać wielomianu. Składa się ona
+ * z nagłówka (sygnatura, wersja formatu i długość drzewa), drzewa
+ * jednomianów zakodowanego liczbami o zmiennej długości oraz sumy kontrolnej.
+ * Rekordy wielu wielomianów można zapisywać jeden za drugim.
+ * @param[in] p : wielomian
+ * @param[in,out] buffer : bufor
+ */
+void PolySerialize(const Poly *p, PolyBuffer *buffer);
+
+/**
+ * Odczytuje wielomian zapisany przez PolySerialize z początku danych.
+ * Sprawdza sygnaturę, wersję formatu, sumę kontrolną oraz to, czy zapisany
+ * wielomian jest w postaci kanonicznej. Odrzuca wielomiany zagnieżdżone na
+ * więcej niż 10000 poziomów. Nie kopiuje danych, więc można ich używać
+ * bezpośrednio z pliku odwzorowanego w pamięci.
+ * @param[in] data : dane
+ * @param[in] size : liczba bajtów danych
+ * @param[out] p : odczytany wielomian, jeśli dane są poprawne
+ * @return liczba odczytanych bajtów lub 0, jeśli dane są niepoprawne
  */
-Poly PolyFromString(const char **line);
+size_t PolyDeserialize(const char *data, size_t size, Poly *p);
 
 /**
- * Funkcja zakłada, że linia zawiera poprawnie opisany jednomian.
- * Tworzy jednomian z ciągu znaków.
+ * Funkcja w jednym przejściu sprawdza poprawność linii i tworzy z niej
+ * wielomian. Linia musi zawierać dokładnie jeden wielomian zakończony
+ * znakiem '\n' lub końcem napisu.
+ * @param[in] line : linia z wielomianem
+ * @param[out] result : wczytany wielomian, jeśli linia jest poprawna
+ * @return czy linia opisuje poprawny wielomian
  */
-Mono MonoFromString(const char **line);
+bool PolyFromString(const char *line, Poly *result);
 
 #endif /* __POLY_H__ */
@@ -0,0 +1,244 @@
+/** @file
+  Implementacja wczytywania wielomianu z linii wejścia kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#include "poly.h"
+#include "characters.h"
+#include "stats.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <limits.h>
+
+/// Makro funkcji PolyFromCoeff.
+#define C PolyFromCoeff
+
+// Znaki.
+#define OPEN_PARENTHESIS '('    ///< Stała oznaczająca znak '('.
+#define CLOSE_PARENTHESIS ')'   ///< Stała oznaczająca znak ')'.
+#define PLUS '+'                ///< Stała oznaczająca znak '+'.
+#define COMMA ','               ///< Stała oznaczająca znak ','.
+
+// Stałe liczbowe.
+#define DECIMAL_BASE 10         ///< Stała oznaczająca bazę systemu dziesiątkowego.
+#define INITIAL_SIZE 4          ///< Stała oznaczająca początkowy rozmiar tablicy.
+
+/**
+ * Funkcja wczytuje współczynnik postaci '-'? cyfra+ i przesuwa wskaźnik
+ * za jego ostatnią cyfrę. Zwraca false, jeśli nie ma żadnej cyfry lub
+ * współczynnik nie mieści się w przedziale <LONG_MIN, LONG_MAX>.
+ */
+static bool ParseCoeff(const char **line, poly_coeff_t *coeff) {
+    bool negative = (**line == MINUS);
+    if (negative) *line += 1;
+    if (!IsDigit(**line)) return false;
+
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+    unsigned long value = 0;
+    bool overflow = false;
+    while (IsDigit(**line)) {
+        unsigned long digit = **line - ASCII_ZERO;
+        if (value > (limit - digit) / DECIMAL_BASE) overflow = true;
+        else value = value * DECIMAL_BASE + digit;
+        *line += 1;
+    }
+    if (overflow) return false;
+    *coeff = negative ? (poly_coeff_t)(0 - value) : (poly_coeff_t)value;
+    return true;
+}
+
+/**
+ * Funkcja wczytuje wykładnik postaci cyfra+ i przesuwa wskaźnik za jego
+ * ostatnią cyfrę. Zwraca false, jeśli nie ma żadnej cyfry lub wykładnik
+ * nie mieści się w przedziale <0, INT_MAX>.
+ */
+static bool ParseExp(const char **line, poly_exp_t *exp) {
+    if (!IsDigit(**line)) return false;
+
+    long value = 0;
+    bool overflow = false;
+    while (IsDigit(**line)) {
+        if (!overflow) {
+            value = value * DECIMAL_BASE + (**line - ASCII_ZERO);
+            if (value > INT_MAX) overflow = true;
+        }
+        *line += 1;
+    }
+    if (overflow) return false;
+    *exp = (poly_exp_t)value;
+    return true;
+}
+
+/**
+ * Struktura przechowująca jednomiany wczytane dotąd na jednym poziomie
+ * zagnieżdżenia nawiasów.
+ */
+typedef struct ParseFrame {
+    Mono *arr;          ///< tablica wczytanych jednomianów
+    size_t size;        ///< liczba wczytanych jednomianów
+    size_t capacity;    ///< rozmiar tablicy
+    bool sorted;        ///< czy wykładniki są dotąd ściśle rosnące
+} ParseFrame;
+
+/**
+ * Jawny stos poziomów zagnieżdżenia parsera. Dzięki niemu głębokość
+ * rekurencji nie zależy ani od liczby składników, ani od zagnieżdżenia.
+ */
+typedef struct ParseStack {
+    ParseFrame *frames; ///< tablica poziomów
+    size_t depth;       ///< liczba otwartych poziomów
+    size_t capacity;    ///< rozmiar tablicy poziomów
+} ParseStack;
+
+/**
+ * Funkcja otwiera nowy, pusty poziom zagnieżdżenia.
+ */
+static void PushFrame(ParseStack *stack) {
+    if (stack->depth == stack->capacity) {
+        stack->capacity = stack->capacity == 0 ? INITIAL_SIZE : 2 * stack->capacity;
+        stack->frames = realloc(stack->frames, stack->capacity * sizeof(ParseFrame));
+        if (stack->frames == NULL) exit(1);
+    }
+    stack->frames[stack->depth++] =
+        (ParseFrame) {.arr = NULL, .size = 0, .capacity = 0, .sorted = true};
+}
+
+/**
+ * Funkcja dopisuje jednomian do najgłębszego otwartego poziomu.
+ * Jednomiany zerowe pomija, a przy okazji sprawdza, czy wykładniki
+ * nadal są ściśle rosnące.
+ */
+static void AppendMono(ParseStack *stack, Mono m) {
+    if (PolyIsZero(&m.p)) return;
+
+    ParseFrame *frame = &stack->frames[stack->depth - 1];
+    if (frame->size > 0 && frame->arr[frame->size - 1].exp >= m.exp) {
+        frame->sorted = false;
+    }
+    if (frame->size == frame->capacity) {
+        frame->capacity = frame->capacity == 0 ? INITIAL_SIZE : 2 * frame->capacity;
+        frame->arr = MonosRealloc(frame->arr, frame->capacity);
+        if (frame->arr == NULL) exit(1);
+    }
+    frame->arr[frame->size++] = m;
+}
+
+/**
+ * Funkcja zamyka najgłębszy poziom i tworzy z jego jednomianów wielomian.
+ * Wielomiany wypisane przez PolyPrint mają jednomiany posortowane, bez
+ * powtórzeń wykładników, więc w typowym przypadku tablica poziomu staje
+ * się od razu tablicą wielomianu, bez sortowania i scalania.
+ */
+static Poly PopFrame(ParseStack *stack) {
+    ParseFrame *frame = &stack->frames[--stack->depth];
+    if (!frame->sorted) {
+        return PolyOwnMonos(frame->size, frame->arr);
+    }
+    else if (frame->size == 0) {
+        return PolyZero();
+    }
+    else if (frame->size == 1 && frame->arr[0].exp == 0 &&
+             PolyIsCoeff(&frame->arr[0].p)) {
+        poly_coeff_t coeff = frame->arr[0].p.coeff;
+        MonosFree(frame->arr);
+        return C(coeff);
+    }
+    else {
+        if (frame->size < frame->capacity) {
+            frame->arr = MonosRealloc(frame->arr, frame->size);
+            if (frame->arr == NULL) exit(1);
+        }
+        return (Poly) {.size = frame->size, .arr = frame->arr};
+    }
+}
+
+/**
+ * Funkcja usuwa z pamięci wszystkie jednomiany z otwartych poziomów
+ * oraz sam stos.
+ */
+static void ParseStackDestroy(ParseStack *stack) {
+    for (size_t i = 0; i < stack->depth; i++) {
+        for (size_t j = 0; j < stack->frames[i].size; j++) {
+            MonoDestroy(&stack->frames[i].arr[j]);
+        }
+        MonosFree(stack->frames[i].arr);
+    }
+    free(stack->frames);
+}
+
+/**
+ * Funkcja wczytuje sumę jednomianów, zaczynającą się znakiem '('.
+ * Każdy znak '(' otwiera jednomian na najgłębszym poziomie; jeśli zaraz
+ * po nim występuje kolejny '(', współczynnik jednomianu jest wielomianem,
+ * więc otwieramy nowy poziom. Po wczytaniu wykładnika znak ',' oznacza
+ * koniec wielomianu z najgłębszego poziomu, który staje się
+ * współczynnikiem jednomianu poziom wyżej. W razie błędu zwraca false,
+ * a jednomiany pozostałe na stosie usuwa wywołujący.
+ */
+static bool ParseMonos(const char *line, ParseStack *stack, Poly *result) {
+    PushFrame(stack);
+    while (true) {
+        line++; // Pomijam znak '('.
+        if (*line == OPEN_PARENTHESIS) {
+            PushFrame(stack);
+            continue;
+        }
+
+        poly_coeff_t coeff;
+        if (!ParseCoeff(&line, &coeff)) return false;
+        Poly value = C(coeff);
+        // Domykamy jednomiany, dopóki po wielomianie występuje wykładnik.
+        while (true) {
+            poly_exp_t exp;
+            if (*line != COMMA) {
+                PolyDestroy(&value);
+                return false;
+            }
+            line++;
+            if (!ParseExp(&line, &exp) || *line != CLOSE_PARENTHESIS) {
+                PolyDestroy(&value);
+                return false;
+            }
+            line++; // Pierwszy znak po zamykającym nawiasie.
+            AppendMono(stack, (Mono) {.p = value, .exp = exp});
+
+            if (*line == PLUS) {
+                line++;
+                if (*line != OPEN_PARENTHESIS) return false;
+                break;
+            }
+            else if (*line == COMMA && stack->depth > 1) {
+                value = PopFrame(stack);
+            }
+            else if (IsLineEnd(*line) && stack->depth == 1) {
+                *result = PopFrame(stack);
+                return true;
+            }
+            else {
+                return false;
+            }
+        }
+    }
+}
+
+bool PolyFromString(const char *line, Poly *result) {
+    // Jeżeli pierwszy znak nie jest znakiem '(', wielomian musi być
+    // współczynnikiem zajmującym całą linię.
+    if (*line != OPEN_PARENTHESIS) {
+        poly_coeff_t coeff;
+        if (!ParseCoeff(&line, &coeff) || !IsLineEnd(*line)) return false;
+        *result = C(coeff);
+        return true;
+    }
+
+    TraceBegin(TRACE_OP, "PolyFromString");
+    TraceBegin(TRACE_PHASE, "parse");
+    ParseStack stack = {.frames = NULL, .depth = 0, .capacity = 0};
+    bool correct = ParseMonos(line, &stack, result);
+    ParseStackDestroy(&stack);
+    TraceEnd(TRACE_PHASE);
+    TraceEnd(TRACE_OP);
+    return correct;
+}
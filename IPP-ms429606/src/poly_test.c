@@ -2,13 +2,22 @@
 #undef NDEBUG
 #endif
 
+#define _GNU_SOURCE
+
 #include "poly.h"
+#include "expr.h"
+#include "program.h"
+#include "output.h"
+#include "stats.h"
+#include "trace.h"
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /** DANE DO TESTÓW **/
 
@@ -3827,6 +3836,31 @@ static bool MulTest2(void) {
   return good;
 }
 
+/**
+ * Sprawdza mnożenie przez wielomian o jednym jednomianie, z obu stron, dla
+ * jednomianu ze współczynnikiem, z zagnieżdżonym wielomianem i dla
+ * jednomianów, które wyzerowały się przez przepełnienie.
+ */
+static bool MulByMonoTest(void) {
+  bool res = true;
+  res &= TestMul(P(C(1), 0, C(2), 1),
+                 P(C(3), 2),
+                 P(C(3), 2, C(6), 3));
+  res &= TestMul(P(C(3), 2),
+                 P(C(1), 0, C(2), 1),
+                 P(C(3), 2, C(6), 3));
+  res &= TestMul(P(P(C(1), 0, C(1), 1), 0, C(2), 3),
+                 P(P(C(2), 1), 4),
+                 P(P(C(2), 1, C(2), 2), 4, P(C(4), 1), 7));
+  res &= TestMul(P(C(LONG_MIN), 1, C(1), 2),
+                 P(C(2), 3),
+                 P(C(2), 5));
+  res &= TestMul(P(C(2), 3),
+                 P(C(LONG_MIN), 1, P(C(LONG_MIN), 1), 2),
+                 C(0));
+  return res;
+}
+
 /**
  * Sprawdza poprawność działania funkcji PolyIsEq na dłuższych przykładach.
  */
@@ -3967,6 +4001,714 @@ static bool MemoryFreeTest(void) {
   return res;
 }
 
+/**
+ * Sprawdza scalanie więcej niż dwóch jednomianów o tym samym wykładniku,
+ * które częściowo się znoszą, np. (2,3)+(-2,3)+(1,3), w PolyAddMonos,
+ * PolyCloneMonos i PolyOwnMonos.
+ */
+static bool AddMonosMergeTest(void) {
+  bool res = true;
+  {
+    Mono m[] = {M(C(2), 3), M(C(-2), 3), M(C(1), 3)};
+    res &= TestAddMonos(3, m, P(C(1), 3));
+  }
+  {
+    Mono m[] = {M(C(1), 3), M(C(2), 3), M(C(-2), 3)};
+    res &= TestAddMonos(3, m, P(C(1), 3));
+  }
+  {
+    Mono m[] = {M(C(2), 3), M(C(5), 0), M(C(-2), 3), M(C(1), 3)};
+    res &= TestAddMonos(4, m, P(C(5), 0, C(1), 3));
+  }
+  {
+    Mono m[] = {M(C(1), 3), M(C(-1), 3), M(C(1), 3), M(C(-1), 3)};
+    res &= TestAddMonos(4, m, C(0));
+  }
+  {
+    Mono m[] = {M(P(C(2), 1), 3), M(P(C(-2), 1, C(1), 2), 3), M(C(1), 3)};
+    res &= TestAddMonos(3, m, P(P(C(1), 0, C(1), 2), 3));
+  }
+  {
+    Mono m[] = {M(C(2), 3), M(C(-2), 3), M(C(1), 3)};
+    Poly p = PolyCloneMonos(3, m);
+    res &= TestEq(p, P(C(1), 3), true);
+    for (size_t i = 0; i < 3; ++i)
+      MonoDestroy(&m[i]);
+  }
+  {
+    Mono *m = calloc(3, sizeof (Mono));
+    CHECK_PTR(m);
+    m[0] = M(C(2), 3);
+    m[1] = M(C(-2), 3);
+    m[2] = M(C(1), 3);
+    res &= TestEq(PolyOwnMonos(3, m), P(C(1), 3), true);
+  }
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyPow daje ten sam wynik co wielokrotne PolyMul,
+ * zarówno dla rozwinięcia wielomianowego, jak i szybkiego potęgowania.
+ */
+static bool PowTest(void) {
+  bool res = true;
+  // 1 + x_0 + x_1 + x_2
+  Poly bases[] = {
+    P(P(P(C(1), 0, C(1), 1), 0, C(1), 1), 0, C(1), 1),
+    P(C(2), 3),
+    P(P(C(-1), 0, C(3), 2), 1),
+    P(C(1), 0, C(-2), 1, C(3), 4, C(1), 7, C(-1), 9),
+    C(-3),
+  };
+  for (size_t i = 0; i < sizeof (bases) / sizeof (bases[0]); ++i) {
+    Poly expected = C(1);
+    for (poly_exp_t n = 0; n <= 20 && res; ++n) {
+      Poly pow = PolyPow(&bases[i], n);
+      res &= PolyIsEq(&pow, &expected);
+      PolyDestroy(&pow);
+      Poly next = PolyMul(&expected, &bases[i]);
+      PolyDestroy(&expected);
+      expected = next;
+    }
+    PolyDestroy(&expected);
+    PolyDestroy(&bases[i]);
+  }
+  Poly zero = C(0);
+  res &= TestEq(PolyPow(&zero, 0), C(1), true);
+
+  // Wykładnik wyniku musi się mieścić w typie poly_exp_t.
+  Poly p = P(C(1), 3);
+  res &= PolyPowFits(&p, INT_MAX / 3);
+  res &= !PolyPowFits(&p, INT_MAX / 3 + 1);
+  res &= TestEq(PolyPow(&p, INT_MAX / 3), P(C(1), INT_MAX / 3 * 3), true);
+  PolyDestroy(&p);
+  p = P(C(1), 0, P(C(1), 0, C(1), INT_MAX / 2 + 1), 1);
+  res &= PolyPowFits(&p, 1);
+  res &= !PolyPowFits(&p, 2);
+  PolyDestroy(&p);
+  p = C(7);
+  res &= PolyPowFits(&p, INT_MAX);
+  PolyDestroy(&p);
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyFma daje ten sam wynik co PolyAdd i PolyMul.
+ */
+static bool FmaTest(void) {
+  bool res = true;
+  Poly polys[] = {
+    C(0),
+    C(3),
+    P(C(1), 0, C(1), 1),
+    P(P(C(1), 1), 0, C(-1), 2),
+    P(P(C(2), 0, C(1), 3), 1, C(-4), 5),
+    P(P(C(-1), 1), 0, C(1), 2),
+  };
+  size_t count = sizeof (polys) / sizeof (polys[0]);
+  for (size_t i = 0; i < count; ++i)
+    for (size_t j = 0; j < count; ++j)
+      for (size_t k = 0; k < count; ++k) {
+        Poly mul = PolyMul(&polys[j], &polys[k]);
+        Poly expected = PolyAdd(&polys[i], &mul);
+        Poly acc = PolyClone(&polys[i]);
+        PolyFma(&acc, &polys[j], &polys[k]);
+        res &= PolyIsEq(&acc, &expected);
+        PolyDestroy(&mul);
+        PolyDestroy(&expected);
+        PolyDestroy(&acc);
+      }
+  // Iloczyn znoszący się z akumulatorem daje zero.
+  Poly acc = P(C(1), 0, C(-1), 2);
+  Poly p = P(C(-1), 0, C(1), 1);
+  Poly q = P(C(1), 0, C(1), 1);
+  PolyFma(&acc, &p, &q);
+  res &= PolyIsZero(&acc);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&acc);
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyAddMany daje ten sam wynik co ciąg wywołań PolyAdd,
+ * dla wszystkich spójnych fragmentów tablicy wielomianów.
+ */
+static bool AddManyTest(void) {
+  bool res = true;
+  Poly polys[] = {
+    C(3),
+    P(C(1), 0, C(1), 1),
+    P(P(C(1), 1), 0, C(-1), 2),
+    C(-3),
+    P(P(C(2), 0, C(1), 3), 1, C(-4), 5),
+    P(C(-1), 1, C(1), 2),
+    P(P(C(-1), 1), 0, C(4), 5),
+    C(LONG_MIN),
+    P(C(-1), 0, P(C(-1), 0, C(-1), 3), 1),
+    C(LONG_MIN),
+  };
+  size_t count = sizeof (polys) / sizeof (polys[0]);
+  for (size_t i = 0; i <= count; ++i)
+    for (size_t j = i; j <= count; ++j) {
+      Poly expected = C(0);
+      for (size_t k = i; k < j; ++k) {
+        Poly sum = PolyAdd(&expected, &polys[k]);
+        PolyDestroy(&expected);
+        expected = sum;
+      }
+      Poly sum = PolyAddMany(j - i, &polys[i]);
+      res &= PolyIsEq(&sum, &expected);
+      PolyDestroy(&sum);
+      PolyDestroy(&expected);
+    }
+  // Wielomiany znoszące się dają zero.
+  Poly opposite[] = {
+    P(P(C(1), 1), 0, C(2), 3),
+    P(P(C(-1), 1), 0),
+    C(5),
+    P(C(-5), 0, C(-2), 3),
+  };
+  Poly sum = PolyAddMany(4, opposite);
+  res &= PolyIsZero(&sum);
+  for (size_t i = 0; i < 4; ++i)
+    PolyDestroy(&opposite[i]);
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyMulMany, z jednym i z wieloma wątkami, daje ten sam
+ * wynik co ciąg wywołań PolyMul, dla wszystkich spójnych fragmentów
+ * tablicy wielomianów.
+ */
+static bool MulManyTest(void) {
+  bool res = true;
+  Poly polys[12];
+  // Wielomiany (k + 1) + (k + 2)x_0 + ... o dwunastu jednomianach, żeby
+  // drzewo iloczynu było liczone w wielu wątkach.
+  for (size_t k = 0; k < 8; ++k) {
+    Mono m[12];
+    for (poly_exp_t i = 0; i < 12; ++i)
+      m[i] = MonoFromPoly(&(Poly){.coeff = (poly_coeff_t)k + i + 1, .arr = NULL}, i);
+    polys[k] = PolyAddMonos(12, m);
+  }
+  polys[8] = C(-2);
+  polys[9] = P(P(C(1), 1), 0, C(-1), 2);
+  polys[10] = C(LONG_MIN);
+  polys[11] = P(C(-1), 1, C(1), 2);
+  size_t count = sizeof (polys) / sizeof (polys[0]);
+  for (size_t i = 0; i <= count; ++i)
+    for (size_t j = i; j <= count; ++j) {
+      Poly expected = C(1);
+      for (size_t k = i; k < j; ++k) {
+        Poly product = PolyMul(&expected, &polys[k]);
+        PolyDestroy(&expected);
+        expected = product;
+      }
+      Poly product = PolyMulMany(j - i, &polys[i], 1);
+      res &= PolyIsEq(&product, &expected);
+      PolyDestroy(&product);
+      product = PolyMulMany(j - i, &polys[i], 4);
+      res &= PolyIsEq(&product, &expected);
+      PolyDestroy(&product);
+      PolyDestroy(&expected);
+    }
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&polys[i]);
+
+  // Iloczyny wielomianów rzadkich nie tracą jednomianów, więc są liczone
+  // w drzewie, także w wielu wątkach i dla nieparzystej liczby czynników.
+  Poly sparse[5];
+  for (poly_exp_t k = 0, base = 1; k < 5; ++k, base *= 8) {
+    Mono m[8];
+    for (poly_exp_t i = 0; i < 8; ++i)
+      m[i] = MonoFromPoly(&(Poly){.coeff = k + i + 1, .arr = NULL}, i * base);
+    sparse[k] = PolyAddMonos(8, m);
+  }
+  for (size_t n = 3; n <= 5; ++n) {
+    Poly expected = PolyMul(&sparse[0], &sparse[1]);
+    for (size_t k = 2; k < n; ++k) {
+      Poly product = PolyMul(&expected, &sparse[k]);
+      PolyDestroy(&expected);
+      expected = product;
+    }
+    for (size_t threads = 1; threads <= 4; threads += 3) {
+      Poly product = PolyMulMany(n, sparse, threads);
+      res &= PolyIsEq(&product, &expected);
+      PolyDestroy(&product);
+    }
+    PolyDestroy(&expected);
+  }
+  for (size_t k = 0; k < 5; ++k)
+    PolyDestroy(&sparse[k]);
+  return res;
+}
+
+/**
+ * Sprawdza, czy przydziały tablic jednomianów w operacjach na wielomianach
+ * są liczone w statystykach dołączonych do wątku i czy po usunięciu
+ * wielomianów nie zostają zajęte bajty.
+ */
+static bool StatsTest(void) {
+  bool res = true;
+  Stats stats;
+  StatsInit(&stats);
+  StatsAttach((StatsScope) {.stats = &stats, .row = STATS_NO_ROW});
+  Poly p = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  Poly q = P(C(1), 0, C(-1), 3);
+  StatsBegin(0, "MUL");
+  Poly product = PolyMul(&p, &q);
+  StatsEnd();
+  Poly sum = PolyAdd(&product, &p);
+  res &= stats.rows[0].calls == 1;
+  res &= atomic_load(&stats.rows[0].monos) > 0;
+  res &= atomic_load(&stats.rows[0].bytes) <= atomic_load(&stats.bytes);
+  res &= stats.rows[0].peak_live_bytes <= atomic_load(&stats.peak_live_bytes);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&product);
+  PolyDestroy(&sum);
+  res &= atomic_load(&stats.live_bytes) == 0;
+  char *text = StatsFormat(&stats);
+  res &= strstr(text, "\"MUL\":{\"calls\":1,") != NULL;
+  free(text);
+  StatsAttach((StatsScope) {.stats = NULL, .row = STATS_NO_ROW});
+  StatsDestroy(&stats);
+  return res;
+}
+
+/**
+ * Sprawdza, czy ślad zawiera operacje na wielomianach i ich etapy, bez
+ * operacji zagnieżdżonych, i czy każde zdarzenie początku ma swój koniec.
+ */
+static bool TraceTest(void) {
+  bool res = true;
+  char path[] = "/tmp/poly_trace_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return false;
+  close(fd);
+  res &= TraceOpen(path);
+  Poly p = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  Poly q = P(C(1), 0, C(-1), 3);
+  TraceLineBegin("MUL", 1);
+  Poly product = PolyMul(&p, &q);
+  TraceLineEnd();
+  Poly composed = PolyCompose(&p, 1, &q);
+  TraceClose();
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&product);
+  PolyDestroy(&composed);
+
+  FILE *f = fopen(path, "r");
+  char text[1 << 14];
+  size_t size = f == NULL ? 0 : fread(text, 1, sizeof (text) - 1, f);
+  text[size] = '\0';
+  if (f != NULL)
+    fclose(f);
+  unlink(path);
+  res &= size > 0 && size < sizeof (text) - 1;
+  res &= text[0] == '[' && strcmp(text + size - 3, "\n]\n") == 0;
+  res &= strstr(text, "\"name\":\"MUL\",\"cat\":\"line\"") != NULL;
+  res &= strstr(text, "\"args\":{\"line\":1}") != NULL;
+  res &= strstr(text, "\"name\":\"sort\"") != NULL;
+  res &= strstr(text, "\"name\":\"multiply\"") != NULL;
+  res &= strstr(text, "\"name\":\"PolyCompose\"") != NULL;
+  size_t begins = 0, ends = 0, muls = 0;
+  for (const char *c = strstr(text, "\"ph\":\"B\""); c != NULL;
+       c = strstr(c + 1, "\"ph\":\"B\""))
+    ++begins;
+  for (const char *c = strstr(text, "\"ph\":\"E\""); c != NULL;
+       c = strstr(c + 1, "\"ph\":\"E\""))
+    ++ends;
+  for (const char *c = strstr(text, "\"PolyMul\""); c != NULL;
+       c = strstr(c + 1, "\"PolyMul\""))
+    ++muls;
+  // Mnożenia wewnątrz PolyMul i PolyCompose nie trafiają do śladu.
+  res &= begins > 0 && begins == ends && muls == 1;
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolySquare daje ten sam wynik co PolyMul(p, p), a PolySub
+ * ten sam co dodanie wielomianu przeciwnego, dla wszystkich par wielomianów.
+ */
+static bool SquareAndSubTest(void) {
+  bool res = true;
+  Poly polys[] = {
+    C(0),
+    C(LONG_MIN),
+    C(3),
+    P(C(1), 0, C(1), 1),
+    P(C(-1), 0, C(-1), 1),
+    P(P(C(1), 1), 0, C(-1), 2),
+    P(P(C(2), 0, C(LONG_MIN), 3), 1, C(-4), 5),
+    P(C(LONG_MAX), 0, P(C(-1), 0, C(-1), 3), 1, C(7), 4),
+    P(P(C(LONG_MIN), 1), 2, P(C(1), 0, C(3), 1), 6),
+  };
+  size_t count = sizeof (polys) / sizeof (polys[0]);
+  for (size_t i = 0; i < count; ++i) {
+    Poly square = PolySquare(&polys[i]);
+    Poly expected = PolyMul(&polys[i], &polys[i]);
+    res &= PolyIsEq(&square, &expected);
+    PolyDestroy(&square);
+    PolyDestroy(&expected);
+    for (size_t j = 0; j < count; ++j) {
+      Poly neg = PolyNeg(&polys[j]);
+      expected = PolyAdd(&polys[i], &neg);
+      Poly difference = PolySub(&polys[i], &polys[j]);
+      res &= PolyIsEq(&difference, &expected);
+      PolyDestroy(&difference);
+      PolyDestroy(&expected);
+      PolyDestroy(&neg);
+    }
+  }
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyScale daje ten sam wynik co PolyMul przez współczynnik,
+ * także gdy przepełnienie zeruje część jednomianów.
+ */
+static bool ScaleTest(void) {
+  bool res = true;
+  const poly_coeff_t scalars[] = {0, 1, -1, 3, 1L << 62};
+  for (size_t i = 0; i < sizeof (scalars) / sizeof (scalars[0]); ++i) {
+    Poly polys[] = {
+      C(5),
+      P(C(1), 0, C(-2), 1, C(4), 3),
+      P(P(C(4), 0, C(1), 2), 0, C(-3), 1),
+      P(P(C(4), 1), 0, C(2), 1),
+    };
+    for (size_t j = 0; j < sizeof (polys) / sizeof (polys[0]); ++j) {
+      Poly c = C(scalars[i]);
+      Poly expected = PolyMul(&polys[j], &c);
+      PolyScale(&polys[j], scalars[i]);
+      res &= PolyIsEq(&polys[j], &expected);
+      PolyDestroy(&expected);
+      PolyDestroy(&polys[j]);
+    }
+  }
+  // Wielomian 1 + 4y^2 razy 2^62 staje się współczynnikiem.
+  Poly p = P(P(C(1), 0, C(4), 2), 0);
+  PolyScale(&p, 1L << 62);
+  res &= PolyIsCoeff(&p) && p.coeff == 1L << 62;
+  PolyDestroy(&p);
+  return res;
+}
+
+/**
+ * Sprawdza, czy PolyFormat wypisuje wielomiany w formacie wejścia
+ * kalkulatora i dopisuje je na koniec bufora.
+ */
+static bool FormatTest(void) {
+  bool res = true;
+  PolyBuffer buffer = {NULL, 0, 0};
+  Poly p = C(LONG_MIN);
+  PolyFormat(&p, &buffer);
+  res &= buffer.size == strlen("-9223372036854775808") &&
+         memcmp(buffer.data, "-9223372036854775808", buffer.size) == 0;
+  PolyDestroy(&p);
+
+  // Formatowanie dopisuje na koniec bufora.
+  buffer.size = 0;
+  const char *expected = "0(1,0)+((-2,1),2)+((3,0)+(4,2),2147483647)";
+  Poly polys[] = {
+    C(0),
+    P(C(1), 0, P(C(-2), 1), 2, P(C(3), 0, C(4), 2), INT_MAX),
+  };
+  for (size_t i = 0; i < sizeof (polys) / sizeof (polys[0]); ++i) {
+    PolyFormat(&polys[i], &buffer);
+    PolyDestroy(&polys[i]);
+  }
+  res &= buffer.size == strlen(expected) &&
+         memcmp(buffer.data, expected, buffer.size) == 0;
+  free(buffer.data);
+  return res;
+}
+
+/**
+ * Sprawdza, czy rekordy zapisane przez PolySerialize są odczytywane przez
+ * PolyDeserialize bez zmian, a uszkodzone lub ucięte są odrzucane.
+ */
+static bool SerializeTest(void) {
+  bool res = true;
+  Poly polys[] = {
+    C(0),
+    C(LONG_MIN),
+    C(LONG_MAX),
+    P(C(1), 0, P(C(-2), 1), 2, P(C(3), 0, C(4), 2), INT_MAX),
+    P(P(P(C(-1), 7), 1), 0),
+    P(C(5), INT_MAX),
+    P(P(C(1), INT_MAX), INT_MAX),
+  };
+  const size_t count = sizeof (polys) / sizeof (polys[0]);
+  PolyBuffer buffer = {NULL, 0, 0};
+  for (size_t i = 0; i < count; ++i)
+    PolySerialize(&polys[i], &buffer);
+
+  // Rekordy zapisane jeden za drugim odczytujemy po kolei.
+  size_t pos = 0;
+  for (size_t i = 0; i < count; ++i) {
+    Poly p;
+    size_t size = PolyDeserialize(buffer.data + pos, buffer.size - pos, &p);
+    res &= size > 0;
+    if (size > 0) {
+      res &= PolyIsEq(&p, &polys[i]);
+      PolyDestroy(&p);
+    }
+    pos += size;
+  }
+  res &= pos == buffer.size;
+
+  // Uszkodzony lub ucięty rekord jest odrzucany.
+  buffer.size = 0;
+  PolySerialize(&polys[3], &buffer);
+  for (size_t i = 0; i < buffer.size; ++i) {
+    Poly p;
+    buffer.data[i] ^= 1;
+    res &= PolyDeserialize(buffer.data, buffer.size, &p) == 0;
+    buffer.data[i] ^= 1;
+    res &= PolyDeserialize(buffer.data, i, &p) == 0;
+  }
+
+  // Zbyt głęboko zagnieżdżony wielomian jest odrzucany.
+  for (size_t depth = 1000; depth <= 20000; depth += 19000) {
+    Poly p = C(1);
+    for (size_t i = 0; i < depth; ++i) {
+      Mono *m = malloc(sizeof (Mono));
+      CHECK_PTR(m);
+      m[0] = M(p, 1);
+      p = PolyOwnMonos(1, m);
+    }
+    buffer.size = 0;
+    PolySerialize(&p, &buffer);
+    Poly q;
+    size_t size = PolyDeserialize(buffer.data, buffer.size, &q);
+    res &= (size > 0) == (depth == 1000);
+    if (size > 0) {
+      res &= PolyIsEq(&p, &q);
+      PolyDestroy(&q);
+    }
+    PolyDestroy(&p);
+  }
+
+  for (size_t i = 0; i < count; ++i)
+    PolyDestroy(&polys[i]);
+  free(buffer.data);
+  return res;
+}
+
+/**
+ * Sprawdza wartości leniwych wyrażeń, także współdzielonych, oraz to, że
+ * długi ciąg mnożeń i dodawań można wyliczyć i zwolnić bez przepełnienia
+ * stosu wywołań.
+ */
+static bool ExprTest(void) {
+  bool res = true;
+  // (x + 1) * (x - 1) - x^2 + 3 = 2
+  Expr *e = ExprMul(ExprAdd(ExprFromPoly(P(C(1), 1)), ExprFromPoly(C(1))),
+                    ExprSub(ExprFromPoly(P(C(1), 1)), ExprFromPoly(C(1))));
+  e = ExprAdd(ExprSub(e, ExprFromPoly(P(C(1), 2))), ExprFromPoly(C(3)));
+  res &= TestEq(ExprTake(e), C(2), true);
+
+  // Współdzielona suma jest liczona raz, a jej wartość zostaje dla
+  // drugiego właściciela: (x + 1)^2 - (x + 1) = x^2 + x.
+  Expr *s = ExprAdd(ExprFromPoly(P(C(1), 1)), ExprFromPoly(C(1)));
+  e = ExprMul(ExprShare(s), ExprShare(s));
+  e = ExprAdd(ExprNeg(ExprShare(s)), e);
+  res &= TestEq(ExprTake(e), P(C(1), 1, C(1), 2), true);
+  res &= TestEq(ExprTake(s), P(C(1), 0, C(1), 1), true);
+
+  // Ciągi znacznie dłuższe niż EXPR_MAX_DEPTH.
+  const poly_exp_t length = 60000;
+  e = ExprFromPoly(C(1));
+  for (poly_exp_t i = 0; i < length; ++i)
+    e = ExprMul(e, ExprFromPoly(P(C(1), 1)));
+  res &= TestEq(ExprTake(e), P(C(1), length), true);
+
+  e = ExprFromPoly(C(0));
+  for (poly_exp_t i = 0; i < length; ++i)
+    e = ExprSub(ExprFromPoly(P(C(1), 1)), ExprMul(e, ExprFromPoly(C(1))));
+  ExprRelease(e);
+  return res;
+}
+
+/**
+ * Kompiluje i wykonuje linie z napisu @p input programem, który łączy
+ * operacje w pary, jeśli @p optimize jest prawdą, i wtedy na końcu wypisuje
+ * raport połączeń. Sprawdza, czy wyniki i komunikaty o błędach, wypisane
+ * razem w kolejności, są równe @p expected.
+ */
+static bool TestProgram(const char *input, bool optimize, const char *expected) {
+  char path[] = "/tmp/poly_program_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return false;
+  OutputRedirect(fd, fd);
+  Stack stack;
+  Init(&stack, false);
+  Registers memory;
+  RegistersInit(&memory);
+  Program program;
+  ProgramInit(&program, optimize);
+  int line_number = 0;
+  for (const char *line = input; *line != '\0';) {
+    const char *end = strchr(line, '\n');
+    size_t size = end == NULL ? strlen(line) : (size_t)(end - line + 1);
+    Op op;
+    if (CompileLine(line, size, ++line_number, &op))
+      ProgramFeed(&program, &op, &stack, &memory);
+    line += size;
+  }
+  ProgramFinish(&program, &stack, &memory);
+  if (optimize)
+    ProgramReport(&program);
+  OutputFlush();
+  StackDestroy(&stack);
+  RegistersDestroy(&memory);
+
+  size_t length = strlen(expected);
+  char *text = malloc(length + 2);
+  CHECK_PTR(text);
+  ssize_t size = pread(fd, text, length + 1, 0);
+  close(fd);
+  unlink(path);
+  bool res = size == (ssize_t)length && memcmp(text, expected, length) == 0;
+  free(text);
+  return res;
+}
+
+/**
+ * Sprawdza, czy linie są kompilowane do operacji z poprawnymi wynikami
+ * i komunikatami o błędach.
+ */
+static bool CompileTest(void) {
+  bool res = true;
+  res &= TestProgram("# komentarz\n\n(1,2)+(2,3)\nPRINT\n", false,
+                     "(1,2)+(2,3)\n");
+  res &= TestProgram("-5\nPRINT\nDEG\n", false, "-5\n0\n");
+  res &= TestProgram(" 1\n(1,2\n1 \n", false,
+                     "ERROR 1 WRONG POLY\nERROR 2 WRONG POLY\n"
+                     "ERROR 3 WRONG POLY\n");
+  res &= TestProgram("PRINTX\nAT\nDEG_BY x\n", false,
+                     "ERROR 1 WRONG COMMAND\nERROR 2 AT WRONG VALUE\n"
+                     "ERROR 3 DEG BY WRONG VARIABLE\n");
+  res &= TestProgram("PRINT\n1\nADD\n", false,
+                     "ERROR 1 STACK UNDERFLOW\nERROR 3 STACK UNDERFLOW\n");
+  res &= TestProgram("(1,3)\nPOW 1000000000\nPRINT\nPOW 715827882\nPRINT\n",
+                     false, "ERROR 2 POW WRONG EXPONENT\n(1,3)\n"
+                     "(1,2147483646)\n");
+  // Ostatnia linia może nie mieć znaku '\n'.
+  res &= TestProgram("2\nPRINT", false, "2\n");
+  return res;
+}
+
+/**
+ * Sprawdza, czy program z łączeniem operacji w pary wypisuje dla @p input
+ * to samo co bez niego, czyli @p expected, oraz raport z podanymi liczbami
+ * połączeń każdego rodzaju.
+ */
+static bool TestFusion(const char *input, const char *expected,
+                       size_t clone_pop, size_t neg_add, size_t clone_mul,
+                       size_t clone_at) {
+  char *fused = malloc(strlen(expected) + 256);
+  CHECK_PTR(fused);
+  sprintf(fused, "%sPEEPHOLE CLONE POP %zu\nPEEPHOLE NEG ADD %zu\n"
+          "PEEPHOLE CLONE MUL %zu\nPEEPHOLE CLONE AT %zu\nPEEPHOLE TOTAL %zu\n",
+          expected, clone_pop, neg_add, clone_mul, clone_at,
+          clone_pop + neg_add + clone_mul + clone_at);
+  bool res = TestProgram(input, false, expected) &&
+             TestProgram(input, true, fused);
+  free(fused);
+  return res;
+}
+
+/**
+ * Sprawdza łączenie par operacji: wyniki i komunikaty o błędach (z numerami
+ * obu linii) są takie jak bez łączenia, także wewnątrz bloków REPEAT,
+ * a pary nie są łączone ponad granicą bloku.
+ */
+static bool FusionTest(void) {
+  bool res = true;
+  // NEG, ADD liczy różnicę bez negowania.
+  res &= TestFusion("(1,1)\n2\nNEG\nADD\nPRINT\n", "(-2,0)+(1,1)\n",
+                    0, 1, 0, 0);
+  res &= TestFusion("1\nNEG\nADD\nPRINT\n", "ERROR 3 STACK UNDERFLOW\n-1\n",
+                    0, 1, 0, 0);
+  // CLONE, POP nie zmienia stosu.
+  res &= TestFusion("(1,2)\nCLONE\nPOP\nPRINT\n", "(1,2)\n", 1, 0, 0, 0);
+  res &= TestFusion("CLONE\nPOP\n",
+                    "ERROR 1 STACK UNDERFLOW\nERROR 2 STACK UNDERFLOW\n",
+                    1, 0, 0, 0);
+  res &= TestFusion("(1,1)\nCLONE\nMUL\nPRINT\n", "(1,2)\n", 0, 0, 1, 0);
+  // CLONE, AT wstawia wartość nad wielomianem.
+  res &= TestFusion("(2,0)+(1,1)\nCLONE\nAT 3\nPRINT\nPOP\nPRINT\n",
+                    "5\n(2,0)+(1,1)\n", 0, 0, 0, 1);
+  res &= TestFusion("1\nCLONE\nAT x\nIS_EQ\n", "ERROR 3 AT WRONG VALUE\n1\n",
+                    0, 0, 0, 0);
+  // W bloku pary są łączone raz, ale wykonywane przy każdym powtórzeniu.
+  res &= TestFusion("1\nREPEAT 2\nCLONE\nPOP\n3\nNEG\nADD\nEND\nPRINT\n",
+                    "-5\n", 1, 1, 0, 0);
+  res &= TestFusion("1\nCLONE\nREPEAT 1\nPOP\nEND\nNEG\nREPEAT 1\nADD\nEND\n"
+                    "PRINT\n", "ERROR 8 STACK UNDERFLOW\n-1\n", 0, 0, 0, 0);
+  return res;
+}
+
+/**
+ * Sprawdza wykonywanie bloków REPEAT, także zagnieżdżonych dużo głębiej,
+ * niż pozwoliłaby rekurencja, i komunikaty o błędach bloków.
+ */
+static bool RepeatTest(void) {
+  bool res = true;
+  res &= TestProgram("1\nREPEAT 2\nREPEAT 3\nCLONE\nADD\nEND\nPRINT\nEND\n",
+                     false, "8\n64\n");
+  res &= TestProgram("1\nREPEAT 0\nPRINT\nEND\nREPEAT 1\nEND\nPRINT\n", false,
+                     "1\n");
+  res &= TestProgram("REPEAT 2\nPOP\nEND\n", false,
+                     "ERROR 2 STACK UNDERFLOW\nERROR 2 STACK UNDERFLOW\n");
+  res &= TestProgram("1\nREPEAT x\nPRINT\nEND\nREPEAT -1\nEND\nREPEAT\nEND\n",
+                     false, "ERROR 2 REPEAT WRONG COUNT\n"
+                     "ERROR 5 REPEAT WRONG COUNT\nERROR 7 REPEAT WRONG COUNT\n");
+  res &= TestProgram("END\nREPEAT 1\nEND\nEND\n", false,
+                     "ERROR 1 WRONG COMMAND\nERROR 4 WRONG COMMAND\n");
+  res &= TestProgram("REPEAT 1\n1\nREPEAT 2\nREPEAT 1\nEND\nPRINT\n", false,
+                     "ERROR 1 REPEAT WITHOUT END\nERROR 3 REPEAT WITHOUT END\n");
+
+  const size_t depth = 100000;
+  const char *open = "REPEAT 1\n", *close = "END\n";
+  const char *body = "1\nCLONE\nADD\nPRINT\n";
+  size_t size = depth * (strlen(open) + strlen(close)) + strlen(body);
+  char *input = malloc(size + 1);
+  CHECK_PTR(input);
+  char *end = input;
+  for (size_t i = 0; i < depth; ++i)
+    end = stpcpy(end, open);
+  end = stpcpy(end, body);
+  for (size_t i = 0; i < depth; ++i)
+    end = stpcpy(end, close);
+  res &= TestProgram(input, false, "2\n");
+  // Bez końców bloków każdy z nich jest zgłaszany, od najwcześniejszego.
+  input[depth * strlen(open) + strlen(body)] = '\0';
+  // Każdy komunikat ma mniej niż 40 znaków.
+  char *expected = malloc(depth * 40 + 1);
+  CHECK_PTR(expected);
+  end = expected;
+  for (size_t i = 1; i <= depth; ++i)
+    end += sprintf(end, "ERROR %zu REPEAT WITHOUT END\n", i);
+  res &= TestProgram(input, false, expected);
+  free(expected);
+  free(input);
+  return res;
+}
+
 /** GRUPY TESTÓW **/
 
 static bool SimpleNegGroup(void) {
@@ -4036,6 +4778,7 @@ static const test_list_t test_list[] = {
   TEST(DegGroup),
   TEST(MulTest1),
   TEST(MulTest2),
+  TEST(MulByMonoTest),
   TEST(AddTest1),
   TEST(AddTest2),
   TEST(SubTest1),
@@ -4046,6 +4789,21 @@ static const test_list_t test_list[] = {
   TEST(MemoryThiefTest),
   TEST(MemoryFreeTest),
   TEST(MemoryGroup),
+  TEST(AddMonosMergeTest),
+  TEST(PowTest),
+  TEST(FmaTest),
+  TEST(AddManyTest),
+  TEST(MulManyTest),
+  TEST(SquareAndSubTest),
+  TEST(StatsTest),
+  TEST(TraceTest),
+  TEST(ScaleTest),
+  TEST(FormatTest),
+  TEST(SerializeTest),
+  TEST(ExprTest),
+  TEST(CompileTest),
+  TEST(RepeatTest),
+  TEST(FusionTest),
 };
 
 int main(int argc, char *argv[]) {
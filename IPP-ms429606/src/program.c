@@ -0,0 +1,390 @@
+/** @file
+  Implementacja kodu pośredniego kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "program.h"
+#include "characters.h"
+#include "instructions.h"
+#include "output.h"
+#include "stats.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Znaki.
+#define COMMENT '#'             ///< Stała oznaczająca znak '#'.
+#define OPEN_PARENTHESIS '('    ///< Stała oznaczająca znak '('.
+
+#define INITIAL_SIZE 16         ///< Stała na początkowy rozmiar tablicy operacji.
+
+/**
+ * Nazwy par instrukcji łączonych przez optymalizację, w kolejności rodzajów
+ * operacji od OP_FIRST_FUSED.
+ */
+static const char *FUSED_NAMES[OP_KIND_COUNT - OP_FIRST_FUSED] = {
+    "CLONE POP", "NEG ADD", "CLONE MUL", "CLONE AT"
+};
+
+/**
+ * Funkcja tworzy operację wypisującą komunikat o błędzie.
+ */
+static void CompileError(const char *message, int line_number, Op *op) {
+    op->kind = OP_ERROR;
+    op->line_number = line_number;
+    op->message = message;
+}
+
+void CompileCommand(InstructionId id, const Parameter *param, int line_number,
+                    Op *op) {
+    if (id == INSTR_REPEAT) op->kind = OP_REPEAT;
+    else if (id == INSTR_END) op->kind = OP_END;
+    else op->kind = OP_COMMAND;
+    op->id = id;
+    op->correct = (param != NULL);
+    op->line_number = line_number;
+    op->jump = 0;
+    op->text = NULL;
+    if (param != NULL) {
+        op->param = *param;
+        // Linia albo ramka z parametrem napisowym przestaje być ważna
+        // przed wykonaniem operacji, więc kopiujemy parametr.
+        if (InstructionParameter(id) == PARAM_TEXT) {
+            op->text = malloc(param->length + 1);
+            if (op->text == NULL) exit(1);
+            memcpy(op->text, param->text, param->length);
+            op->param.text = op->text;
+        }
+    }
+}
+
+bool CompileLine(const char *line, size_t line_size, int line_number, Op *op) {
+    // Linia ze znakiem zerowym jest zawsze błędna, ale polecenie zgłasza
+    // wtedy własny komunikat.
+    if (memchr(line, 0, line_size) != NULL) {
+        if (IsLetter(line[0])) {
+            CompileError(InstructionError(line, strlen(line)), line_number, op);
+        }
+        else {
+            CompileError("WRONG POLY", line_number, op);
+        }
+        return true;
+    }
+    if (IsLineEnd(line[0])) {
+        return false;
+    }
+    char first_char = line[0];
+    if (first_char == COMMENT) {
+        return false;
+    }
+    // Sprawdzamy poprawność wielomianu, jeżeli jest poprawny to zapisujemy
+    // go w operacji.
+    else if (first_char == OPEN_PARENTHESIS || IsDigit(first_char) ||
+             first_char == MINUS) {
+        TraceLineBegin("PUSH", line_number);
+        if (PolyFromString(line, &op->poly)) {
+            op->kind = OP_PUSH;
+            op->line_number = line_number;
+        }
+        else {
+            CompileError("WRONG POLY", line_number, op);
+        }
+        TraceLineEnd();
+    }
+    // Polecenie musi zaczynać się literą, więc jeśli linia nie zaczyna się
+    // literą (w szczególności zaczyna się białym znakiem), zapisujemy
+    // komunikat o błędzie.
+    else if (!IsLetter(first_char)) {
+        CompileError("WRONG POLY", line_number, op);
+    }
+    else {
+        Parameter param;
+        bool correct;
+        InstructionId id = ParseInstruction(line, line_size, &param, &correct);
+        if (id == INSTR_UNKNOWN) CompileError("WRONG COMMAND", line_number, op);
+        else CompileCommand(id, correct ? &param : NULL, line_number, op);
+    }
+    return true;
+}
+
+/**
+ * Funkcja usuwa z pamięci wielomian i parametr operacji.
+ */
+static void OpDestroy(Op *op) {
+    if (op->kind == OP_PUSH) PolyDestroy(&op->poly);
+    else if (op->kind == OP_COMMAND) free(op->text);
+}
+
+/**
+ * Funkcja wykonuje instrukcję albo połączoną parę instrukcji, mierząc jej
+ * wykonanie w statystykach sesji i zapisując je w śladzie. Pary mają
+ * w statystykach własne wiersze, za wierszami instrukcji.
+ */
+static void ExecuteCommandOp(const Op *op, Stack *Polynomials, Registers *Memory) {
+    if (op->kind == OP_COMMAND) {
+        TraceLineBegin(InstructionName(op->id), op->line_number);
+        StatsBegin(op->id, InstructionName(op->id));
+        ExecuteCommand(Polynomials, Memory, op->id,
+                       op->correct ? &op->param : NULL, op->line_number);
+        StatsEnd();
+        TraceLineEnd();
+        return;
+    }
+    TraceLineBegin(FUSED_NAMES[op->kind - OP_FIRST_FUSED], op->line_number);
+    StatsBegin(INSTR_UNKNOWN + op->kind - OP_FIRST_FUSED,
+               FUSED_NAMES[op->kind - OP_FIRST_FUSED]);
+    switch (op->kind) {
+        case OP_CLONE_POP:
+            ClonePop(Polynomials, op->line_number, op->second_line_number);
+            break;
+        case OP_NEG_ADD:
+            NegAdd(Polynomials, op->line_number, op->second_line_number);
+            break;
+        case OP_CLONE_MUL:
+            CloneMul(Polynomials, op->line_number, op->second_line_number);
+            break;
+        case OP_CLONE_AT:
+            CloneAt(Polynomials, (long)op->param.number, op->line_number,
+                    op->second_line_number);
+            break;
+        default:
+            break;
+    }
+    StatsEnd();
+    TraceLineEnd();
+}
+
+/**
+ * To jest struktura przechowująca wykonywany blok REPEAT.
+ */
+typedef struct Loop {
+    size_t begin;           ///< indeks operacji OP_REPEAT bloku
+    unsigned long left;     ///< liczba pozostałych wykonań bloku
+} Loop;
+
+/**
+ * Funkcja wykonuje @p count pierwszych operacji tablicy @p ops.
+ * Operacje zostają w tablicy, więc wielomiany są wstawiane na stos jako
+ * kopie. Blok REPEAT wykonuje tyle razy, ile wynosi jego parametr, po czym
+ * przechodzi za jego koniec. Wykonywane bloki są na jawnym stosie, więc
+ * zagnieżdżenie bloków nie zwiększa zagłębienia wywołań.
+ */
+static void ExecuteOps(Op ops[], size_t count, Stack *Polynomials,
+                       Registers *Memory) {
+    Loop *loops = NULL;
+    size_t depth = 0, capacity = 0;
+    for (size_t i = 0; i < count; i++) {
+        Op *op = &ops[i];
+        switch (op->kind) {
+            case OP_PUSH:
+                Push(Polynomials, PolyClone(&op->poly));
+                break;
+            case OP_COMMAND:
+            case OP_CLONE_POP:
+            case OP_NEG_ADD:
+            case OP_CLONE_MUL:
+            case OP_CLONE_AT:
+                ExecuteCommandOp(op, Polynomials, Memory);
+                break;
+            case OP_ERROR:
+                OutputError(op->line_number, op->message);
+                break;
+            case OP_REPEAT:
+                if (!op->correct) {
+                    OutputError(op->line_number, InstructionParameterError(op->id));
+                }
+                else if (op->jump > i + 1 && op->param.number > 0) {
+                    if (depth == capacity) {
+                        capacity = capacity == 0 ? INITIAL_SIZE : 2 * capacity;
+                        loops = realloc(loops, capacity * sizeof(Loop));
+                        if (loops == NULL) exit(1);
+                    }
+                    loops[depth++] = (Loop) {.begin = i, .left = op->param.number};
+                    break;
+                }
+                i = op->jump;
+                break;
+            case OP_END:
+                // Do końca bloku dochodzimy tylko w najgłębszym wykonywanym
+                // bloku, bo pomijane bloki przeskakujemy.
+                if (--loops[depth - 1].left > 0) i = loops[depth - 1].begin;
+                else depth--;
+                break;
+            default:
+                break;
+        }
+    }
+    free(loops);
+}
+
+void ProgramInit(Program *program, bool optimize) {
+    *program = (Program) {.ops = NULL, .size = 0, .capacity = 0, .depth = 0,
+                          .open = 0, .optimize = optimize, .holding = false};
+}
+
+/**
+ * Funkcja sprawdza, czy operacja może zacząć parę łączonych operacji.
+ */
+static bool StartsPair(const Op *op) {
+    return op->kind == OP_COMMAND && op->correct &&
+           (op->id == INSTR_CLONE || op->id == INSTR_NEG);
+}
+
+/**
+ * Funkcja łączy operację @p first z następującą po niej operacją @p second,
+ * zapisując wynik w @p first. Operacja @p second nie ma wtedy parametru
+ * napisowego, więc nie trzeba jej usuwać.
+ * @return false, jeśli tych operacji nie da się połączyć
+ */
+static bool Fuse(Op *first, const Op *second) {
+    if (!StartsPair(first) || second->kind != OP_COMMAND || !second->correct) {
+        return false;
+    }
+    if (first->id == INSTR_CLONE && second->id == INSTR_POP) first->kind = OP_CLONE_POP;
+    else if (first->id == INSTR_NEG && second->id == INSTR_ADD) first->kind = OP_NEG_ADD;
+    else if (first->id == INSTR_CLONE && second->id == INSTR_MUL) first->kind = OP_CLONE_MUL;
+    else if (first->id == INSTR_CLONE && second->id == INSTR_AT) first->kind = OP_CLONE_AT;
+    else return false;
+    if (first->kind == OP_CLONE_AT) first->param = second->param;
+    first->second_line_number = second->line_number;
+    return true;
+}
+
+/**
+ * Funkcja wykonuje operację czekającą na parę, jeśli taka jest.
+ */
+static void ReleaseHeld(Program *program, Stack *Polynomials, Registers *Memory) {
+    if (program->holding) {
+        program->holding = false;
+        ExecuteOps(&program->held, 1, Polynomials, Memory);
+        OpDestroy(&program->held);
+    }
+}
+
+void ProgramFeed(Program *program, Op *op, Stack *Polynomials, Registers *Memory) {
+    if (op->kind == OP_SYNC) {
+        ReleaseHeld(program, Polynomials, Memory);
+        return;
+    }
+    if (program->optimize) {
+        // W bloku łączymy operację z ostatnią operacją bloku, a poza blokiem
+        // z operacją czekającą na parę.
+        Op *previous = NULL;
+        if (program->depth > 0) previous = &program->ops[program->size - 1];
+        else if (program->holding) previous = &program->held;
+
+        if (previous != NULL && Fuse(previous, op)) {
+            program->rewrites[previous->kind]++;
+            if (program->depth == 0) {
+                program->holding = false;
+                ExecuteOps(previous, 1, Polynomials, Memory);
+                OpDestroy(previous);
+            }
+            return;
+        }
+        ReleaseHeld(program, Polynomials, Memory);
+        if (program->depth == 0 && StartsPair(op)) {
+            program->held = *op;
+            program->holding = true;
+            return;
+        }
+    }
+
+    if (program->depth == 0) {
+        switch (op->kind) {
+            case OP_PUSH:
+                // Wielomian spoza bloku jest potrzebny tylko raz.
+                Push(Polynomials, op->poly);
+                return;
+            case OP_END:
+                OutputError(op->line_number, "WRONG COMMAND");
+                return;
+            case OP_REPEAT:
+                break;
+            default:
+                ExecuteOps(op, 1, Polynomials, Memory);
+                OpDestroy(op);
+                return;
+        }
+    }
+
+    if (program->size == program->capacity) {
+        program->capacity = program->capacity == 0 ? INITIAL_SIZE : 2 * program->capacity;
+        program->ops = realloc(program->ops, program->capacity * sizeof(Op));
+        if (program->ops == NULL) exit(1);
+    }
+    size_t index = program->size++;
+    program->ops[index] = *op;
+    // Otwarte bloki tworzą listę: pole jump otwartego bloku wskazuje blok
+    // otwarty przed nim, dopóki END nie ustawi w nim końca bloku.
+    if (op->kind == OP_REPEAT) {
+        program->ops[index].jump = program->open;
+        program->open = index;
+        program->depth++;
+    }
+    else if (op->kind == OP_END) {
+        size_t begin = program->open;
+        program->open = program->ops[begin].jump;
+        program->ops[begin].jump = index;
+        if (--program->depth == 0) {
+            ExecuteOps(program->ops, program->size, Polynomials, Memory);
+            for (size_t i = 0; i < program->size; i++) {
+                OpDestroy(&program->ops[i]);
+            }
+            program->size = 0;
+        }
+    }
+}
+
+/**
+ * Funkcja wypisuje komunikaty o @p depth niezamkniętych blokach, zaczynając
+ * od bloku otwartego najwcześniej. Najgłębszy z nich ma indeks @p index.
+ */
+static void ReportOpenBlocks(const Op ops[], size_t index, size_t depth) {
+    if (depth == 0) return;
+    // Lista bloków zaczyna się od najgłębszego, więc najpierw zbieramy
+    // ich indeksy.
+    size_t *blocks = malloc(depth * sizeof(size_t));
+    if (blocks == NULL) exit(1);
+    for (size_t k = depth; k > 0; k--) {
+        blocks[k - 1] = index;
+        index = ops[index].jump;
+    }
+    for (size_t k = 0; k < depth; k++) {
+        OutputError(ops[blocks[k]].line_number, "REPEAT WITHOUT END");
+    }
+    free(blocks);
+}
+
+void ProgramFinish(Program *program, Stack *Polynomials, Registers *Memory) {
+    ReleaseHeld(program, Polynomials, Memory);
+    ReportOpenBlocks(program->ops, program->open, program->depth);
+    for (size_t i = 0; i < program->size; i++) {
+        OpDestroy(&program->ops[i]);
+    }
+    free(program->ops);
+    program->ops = NULL;
+    program->size = program->capacity = program->depth = program->open = 0;
+}
+
+void ProgramReport(const Program *program) {
+    // Raport jest jednym komunikatem, więc w protokole binarnym trafia
+    // do jednej ramki.
+    char *text;
+    size_t size;
+    FILE *f = open_memstream(&text, &size);
+    if (f == NULL) exit(1);
+    size_t total = 0;
+    for (int kind = OP_FIRST_FUSED; kind < OP_KIND_COUNT; kind++) {
+        fprintf(f, "PEEPHOLE %s %zu\n", FUSED_NAMES[kind - OP_FIRST_FUSED],
+                program->rewrites[kind]);
+        total += program->rewrites[kind];
+    }
+    fprintf(f, "PEEPHOLE TOTAL %zu", total);
+    if (fclose(f) != 0) exit(1);
+    OutputReport(0, text);
+}
@@ -0,0 +1,136 @@
+/** @file
+  Interfejs kodu pośredniego kalkulatora. Każda linia wejścia (i każda
+  ramka protokołu binarnego) jest raz kompilowana do operacji z wczytanym
+  już wielomianem albo identyfikatorem instrukcji i parametrem. Operacje
+  spoza bloków są wykonywane od razu, a blok REPEAT n ... END jest
+  zbierany do końca i wykonywany n razy z gotowych operacji, bez ponownego
+  czytania linii. Bloki mogą być zagnieżdżone. Blok z niepoprawną liczbą
+  powtórzeń zgłasza błąd REPEAT WRONG COUNT i nie jest wykonywany.
+
+  Program z włączoną optymalizacją łączy pary sąsiednich operacji CLONE, POP;
+  NEG, ADD; CLONE, MUL i CLONE, AT x w jedną operację, która daje ten sam
+  stos, wyjście i komunikaty o błędach (z numerami obu linii), ale nie
+  tworzy kopii ani wyniku pośredniego. Operacja spoza bloku, która może
+  zacząć parę, czeka na następną operację albo na operację OP_SYNC.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __PROGRAM_H__
+#define __PROGRAM_H__
+
+#include "poly.h"
+#include "stack.h"
+#include "registers.h"
+#include "executing_instruction.h"
+
+/**
+ * Rodzaje operacji.
+ */
+typedef enum OpKind {
+    OP_PUSH,        ///< wstawienie wielomianu na stos
+    OP_COMMAND,     ///< wykonanie instrukcji
+    OP_ERROR,       ///< wypisanie komunikatu o błędzie
+    OP_REPEAT,      ///< początek bloku REPEAT
+    OP_END,         ///< koniec bloku REPEAT
+    OP_SYNC,        ///< brak kolejnych danych na wejściu
+    OP_HALT,        ///< koniec wejścia
+    OP_CLONE_POP,   ///< połączone instrukcje CLONE i POP
+    OP_NEG_ADD,     ///< połączone instrukcje NEG i ADD
+    OP_CLONE_MUL,   ///< połączone instrukcje CLONE i MUL
+    OP_CLONE_AT,    ///< połączone instrukcje CLONE i AT
+    OP_KIND_COUNT   ///< liczba rodzajów operacji
+} OpKind;
+
+#define OP_FIRST_FUSED OP_CLONE_POP  ///< Pierwszy rodzaj operacji połączonych.
+
+/**
+ * To jest struktura przechowująca operację.
+ */
+typedef struct Op {
+    /** Rodzaj operacji. */
+    OpKind kind;
+    /** Instrukcja operacji rodzaju OP_COMMAND. */
+    InstructionId id;
+    /** Czy parametr instrukcji lub liczba powtórzeń bloku jest poprawna. */
+    bool correct;
+    /** Numer linii lub ramki, z której powstała operacja. */
+    int line_number;
+    /** Dla operacji połączonych numer linii lub ramki drugiej z nich. */
+    int second_line_number;
+    /** Dla OP_REPEAT indeks operacji kończącej blok. */
+    size_t jump;
+    /** Kopia parametru napisowego, na którą wskazuje param.text, lub NULL. */
+    char *text;
+    union {
+        /** Wielomian operacji rodzaju OP_PUSH. */
+        Poly poly;
+        /** Parametr instrukcji albo liczba powtórzeń bloku. */
+        Parameter param;
+        /** Komunikat operacji rodzaju OP_ERROR. */
+        const char *message;
+    };
+} Op;
+
+/**
+ * To jest struktura przechowująca operacje otwartych bloków REPEAT.
+ */
+typedef struct Program {
+    Op *ops;            ///< tablica operacji
+    size_t size;        ///< liczba operacji
+    size_t capacity;    ///< rozmiar tablicy
+    size_t depth;       ///< liczba otwartych bloków
+    size_t open;        ///< indeks najgłębszego otwartego bloku
+    bool optimize;      ///< czy operacje są łączone w pary
+    bool holding;       ///< czy operacja spoza bloku czeka na następną
+    Op held;            ///< operacja czekająca na następną
+    size_t rewrites[OP_KIND_COUNT]; ///< liczby połączeń każdego rodzaju
+} Program;
+
+/**
+ * Funkcja kompiluje linię wejścia o długości @p line_size do operacji.
+ * Linia jest widokiem na dane wejścia i po kompilacji nie jest potrzebna.
+ * @return false, jeśli linia jest pusta lub jest komentarzem
+ */
+bool CompileLine(const char *line, size_t line_size, int line_number, Op *op);
+
+/**
+ * Funkcja tworzy operację wykonującą instrukcję @p id z parametrem @p param,
+ * kopiując parametr napisowy. NULL oznacza parametr niepoprawny.
+ */
+void CompileCommand(InstructionId id, const Parameter *param, int line_number,
+                    Op *op);
+
+/**
+ * Funkcja tworzy pusty program, który łączy operacje w pary, jeśli
+ * @p optimize jest prawdą.
+ */
+void ProgramInit(Program *program, bool optimize);
+
+/**
+ * Funkcja przyjmuje kolejną operację, przejmując ją na własność. Poza blokiem
+ * wykonuje ją od razu, a w bloku dopisuje ją do programu. Operacja zamykająca
+ * najbardziej zewnętrzny blok wykonuje cały blok i opróżnia program.
+ * Operacja END poza blokiem jest błędem WRONG COMMAND. Operacja OP_SYNC
+ * wykonuje operację czekającą na parę; wywołujący przekazuje ją, zanim
+ * zacznie czekać na dane.
+ */
+void ProgramFeed(Program *program, Op *op, Stack *Polynomials, Registers *Memory);
+
+/**
+ * Funkcja kończy program po końcu wejścia. Wykonuje operację czekającą na
+ * parę, a dla każdego niezamkniętego bloku wypisuje komunikat REPEAT WITHOUT
+ * END z numerem linii jego początku, bloków nie wykonując. Zwalnia pamięć
+ * operacji, ale zachowuje liczby połączeń.
+ */
+void ProgramFinish(Program *program, Stack *Polynomials, Registers *Memory);
+
+/**
+ * Funkcja wypisuje na wyjście diagnostyczne bieżącego wątku (zob. output.h),
+ * ile par operacji każdego rodzaju połączył program, i ich sumę. Wywołujemy
+ * ją przed OutputFlush.
+ */
+void ProgramReport(const Program *program);
+
+#endif /* __PROGRAM_H__ */
@@ -0,0 +1,139 @@
+/** @file
+  Implementacja binarnego protokołu kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "protocol.h"
+#include "program.h"
+#include "output.h"
+#include <string.h>
+
+#define BYTE_BITS 8             ///< Liczba bitów w bajcie.
+#define BYTE_MASK 0xff          ///< Maska najmłodszego bajtu.
+
+/**
+ * Odczytuje liczbę zapisaną na @p size bajtach w kolejności little-endian.
+ */
+static unsigned long LoadLittleEndian(const char *src, size_t size) {
+    unsigned long value = 0;
+    for (size_t i = size; i > 0; i--) {
+        value = (value << BYTE_BITS) | ((unsigned char)src[i - 1] & BYTE_MASK);
+    }
+    return value;
+}
+
+bool ProtocolDetect(Input *in) {
+    char first;
+    return InputPeek(in, &first) && first == PROTOCOL_MAGIC[0];
+}
+
+/**
+ * Funkcja kompiluje ramkę FRAME_PUSH do operacji wstawiającej wielomian.
+ * Dane muszą zawierać dokładnie jeden poprawny rekord.
+ */
+static void CompilePushFrame(const char *data, size_t size, int frame_number,
+                             Op *op) {
+    Poly p;
+    size_t used = PolyDeserialize(data, size, &p);
+    if (used == size && used > 0) {
+        *op = (Op) {.kind = OP_PUSH, .line_number = frame_number, .poly = p};
+    }
+    else {
+        if (used > 0) PolyDestroy(&p);
+        *op = (Op) {.kind = OP_ERROR, .line_number = frame_number,
+                    .message = "WRONG POLY"};
+    }
+}
+
+/**
+ * Funkcja kompiluje ramkę z kodem instrukcji do operacji. Parametr liczbowy
+ * musi mieć dokładnie FRAME_NUMBER_SIZE bajtów, a instrukcja bez parametru
+ * nie może mieć danych.
+ */
+static void CompileCommandFrame(InstructionId id, const char *data, size_t size,
+                                int frame_number, Op *op) {
+    Parameter param = {.number = 0, .text = data, .length = size};
+    bool correct;
+    switch (InstructionParameter(id)) {
+        case PARAM_NONE:
+            if (size != 0) {
+                *op = (Op) {.kind = OP_ERROR, .line_number = frame_number,
+                            .message = "WRONG COMMAND"};
+                return;
+            }
+            correct = true;
+            break;
+        case PARAM_UNSIGNED:
+        case PARAM_SIGNED:
+            correct = (size == FRAME_NUMBER_SIZE);
+            if (correct) param.number = LoadLittleEndian(data, size);
+            break;
+        default:
+            correct = true;
+            break;
+    }
+    CompileCommand(id, correct ? &param : NULL, frame_number, op);
+}
+
+/**
+ * Funkcja wykonuje operację czekającą na parę i wypisuje zebrane wyniki,
+ * zanim ProtocolRun zacznie czekać na dane.
+ */
+static void Sync(Program *program, Stack *Polynomials, Registers *Memory) {
+    Op op = {.kind = OP_SYNC};
+    ProgramFeed(program, &op, Polynomials, Memory);
+    OutputSync();
+}
+
+void ProtocolRun(Input *in, Program *program, Stack *Polynomials,
+                 Registers *Memory) {
+    OutputSetBinary();
+    const char *header;
+    if (!InputRead(in, PROTOCOL_MAGIC_SIZE, &header) ||
+        memcmp(header, PROTOCOL_MAGIC, PROTOCOL_MAGIC_SIZE) != 0) {
+        OutputError(0, "WRONG FRAME");
+        return;
+    }
+
+    int frame_number = 0;
+    while (true) {
+        if (!InputAvailable(in, FRAME_HEADER_SIZE)) Sync(program, Polynomials, Memory);
+        if (!InputRead(in, FRAME_HEADER_SIZE, &header)) {
+            // Po ostatniej ramce zostały bajty, które nie tworzą nagłówka.
+            char c;
+            if (InputPeek(in, &c)) OutputError(frame_number + 1, "WRONG FRAME");
+            break;
+        }
+        frame_number++;
+        // Widok na nagłówek przestaje być ważny po odczytaniu danych.
+        unsigned char kind = header[0];
+        size_t size = LoadLittleEndian(header + 1, FRAME_LENGTH_SIZE);
+
+        // Długości nie ufamy: bufor wejścia rośnie do długości ramki.
+        const char *data;
+        if (size <= FRAME_MAX_SIZE && !InputAvailable(in, size)) {
+            Sync(program, Polynomials, Memory);
+        }
+        if (size > FRAME_MAX_SIZE || !InputRead(in, size, &data)) {
+            OutputError(frame_number, "WRONG FRAME");
+            break;
+        }
+
+        Op op;
+        if (kind == FRAME_PUSH) {
+            CompilePushFrame(data, size, frame_number, &op);
+        }
+        else if (kind < INSTR_UNKNOWN) {
+            CompileCommandFrame((InstructionId)kind, data, size, frame_number, &op);
+        }
+        else {
+            op = (Op) {.kind = OP_ERROR, .line_number = frame_number,
+                       .message = "WRONG COMMAND"};
+        }
+        ProgramFeed(program, &op, Polynomials, Memory);
+    }
+    ProgramFinish(program, Polynomials, Memory);
+}
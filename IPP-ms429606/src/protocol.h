@@ -0,0 +1,73 @@
+/** @file
+  Interfejs binarnego protokołu kalkulatora przeznaczonego dla programów,
+  które nie muszą wtedy ani tworzyć, ani czytać tekstu.
+
+  Strumień zaczyna się czterobajtowym nagłówkiem PROTOCOL_MAGIC, po którym
+  następują ramki. Ramka to bajt rodzaju, długość danych zapisana na
+  czterech bajtach (little-endian) i dane. Ramki wysyłane do kalkulatora:
+  - kod instrukcji (wartość InstructionId) wykonuje instrukcję; dane
+    to parametr: 8 bajtów (little-endian, liczba ze znakiem w kodzie U2)
+    dla parametrów liczbowych, bajty nazwy dla nazw plików i rejestrów
+    i nic dla instrukcji bez parametru,
+  - FRAME_PUSH wstawia na stos wielomian zapisany w danych przez
+    PolySerialize.
+  Ramka dłuższa niż FRAME_MAX_SIZE jest odrzucana jako WRONG FRAME, zanim
+  kalkulator zacznie czytać jej dane, i kończy przetwarzanie wejścia.
+  Ramki INSTR_REPEAT i INSTR_END otwierają i zamykają bloki powtarzanych
+  ramek, tak jak linie REPEAT n i END (zob. program.h); numery ramek
+  w komunikatach o błędach są wtedy numerami ramek z bloku.
+
+  Kalkulator odpowiada tym samym nagłówkiem i ramkami:
+  - FRAME_POLY z wielomianem zapisanym przez PolySerialize,
+  - FRAME_NUMBER z liczbą na 8 bajtach,
+  - FRAME_ERROR z numerem ramki, której dotyczy błąd, na 4 bajtach
+    i treścią komunikatu, takiego samego jak w trybie tekstowym.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include "poly.h"
+#include "stack.h"
+#include "registers.h"
+#include "input.h"
+#include "program.h"
+
+#define PROTOCOL_MAGIC "\177PLY"    ///< Nagłówek strumienia protokołu binarnego.
+#define PROTOCOL_MAGIC_SIZE 4       ///< Długość nagłówka strumienia.
+#define FRAME_HEADER_SIZE 5         ///< Długość nagłówka ramki.
+#define FRAME_LENGTH_SIZE 4         ///< Długość pola z długością danych ramki.
+#define FRAME_NUMBER_SIZE 8         ///< Długość liczby w danych ramki.
+#define FRAME_MAX_SIZE (64UL << 20) ///< Największa długość danych ramki (64 MiB).
+
+/**
+ * Rodzaje ramek, które nie są kodami instrukcji.
+ */
+typedef enum FrameKind {
+    FRAME_PUSH = 0x80,      ///< wielomian do wstawienia na stos
+    FRAME_POLY = 0x81,      ///< wypisany wielomian
+    FRAME_NUMBER = 0x82,    ///< wypisana liczba
+    FRAME_ERROR = 0x83      ///< komunikat o błędzie
+} FrameKind;
+
+/**
+ * Funkcja sprawdza, czy wejście zaczyna się nagłówkiem protokołu binarnego.
+ * Ogląda tylko pierwszy bajt, bo żadna poprawna linia tekstowa nie zaczyna
+ * się od bajtu 0x7f, więc nie czeka na dane dłużej niż tryb tekstowy.
+ */
+bool ProtocolDetect(Input *in);
+
+/**
+ * Funkcja przetwarza wejście w protokole binarnym: sprawdza nagłówek,
+ * po czym przekazuje kolejne ramki programowi @p program, który wykonuje
+ * je na stosie @p Polynomials i rejestrach @p Memory, wypisując wyniki
+ * jako ramki. Zebrane wyniki są wypisywane, zanim funkcja zacznie czekać
+ * na kolejne dane.
+ */
+void ProtocolRun(Input *in, Program *program, Stack *Polynomials,
+                 Registers *Memory);
+
+#endif /* __PROTOCOL_H__ */
@@ -0,0 +1,92 @@
+/** @file
+  Implementacja kolejki jednego producenta i jednego konsumenta.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SPIN_LIMIT 1024         ///< Liczba sprawdzeń kolejki przed uśpieniem wątku.
+
+void QueueInit(Queue *q, size_t item_size, size_t capacity) {
+    q->items = malloc(item_size * capacity);
+    if (q->items == NULL) exit(1);
+    q->item_size = item_size;
+    q->capacity = capacity;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->sleepers, 0);
+    q->cached_head = 0;
+    q->cached_tail = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+}
+
+/**
+ * Funkcja czeka, aż indeks @p index przestanie mieć wartość @p value.
+ * Najpierw krótko sprawdza go w pętli, a potem zasypia. Zwiększenie licznika
+ * śpiących i odczyt indeksu są sekwencyjnie spójne, tak samo jak zapis
+ * indeksu i odczyt licznika w QueueWake, więc któryś z wątków zawsze
+ * zobaczy zmianę drugiego i pobudka nie zginie.
+ */
+static void QueueWait(Queue *q, atomic_size_t *index, size_t value) {
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        if (atomic_load_explicit(index, memory_order_acquire) != value) return;
+    }
+    pthread_mutex_lock(&q->lock);
+    atomic_fetch_add(&q->sleepers, 1);
+    while (atomic_load(index) == value) {
+        pthread_cond_wait(&q->wake, &q->lock);
+    }
+    atomic_fetch_sub(&q->sleepers, 1);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Funkcja budzi wątek śpiący na kolejce, jeśli taki jest.
+ */
+static void QueueWake(Queue *q) {
+    if (atomic_load(&q->sleepers) > 0) {
+        pthread_mutex_lock(&q->lock);
+        pthread_cond_broadcast(&q->wake);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+void QueuePush(Queue *q, const void *item) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail - q->cached_head == q->capacity) {
+        q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+        while (tail - q->cached_head == q->capacity) {
+            QueueWait(q, &q->head, q->cached_head);
+            q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+        }
+    }
+    memcpy(q->items + (tail & (q->capacity - 1)) * q->item_size, item, q->item_size);
+    atomic_store(&q->tail, tail + 1);
+    QueueWake(q);
+}
+
+void QueuePop(Queue *q, void *item) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head == q->cached_tail) {
+        q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        while (head == q->cached_tail) {
+            QueueWait(q, &q->tail, q->cached_tail);
+            q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        }
+    }
+    memcpy(item, q->items + (head & (q->capacity - 1)) * q->item_size, q->item_size);
+    atomic_store(&q->head, head + 1);
+    QueueWake(q);
+}
+
+void QueueDestroy(Queue *q) {
+    free(q->items);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->wake);
+}
@@ -0,0 +1,73 @@
+/** @file
+  Interfejs kolejki jednego producenta i jednego konsumenta (SPSC), którą
+  przekazujemy dane między wątkami kalkulatora. Wstawianie i zdejmowanie
+  nie używają blokad; wątek zasypia na zmiennej warunkowej dopiero wtedy,
+  gdy kolejka długo pozostaje pełna lub pusta.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __QUEUE_H__
+#define __QUEUE_H__
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define CACHE_LINE 64           ///< Rozmiar linii pamięci podręcznej.
+
+/**
+ * To jest struktura przechowująca kolejkę. Elementy mają stały rozmiar
+ * i leżą w tablicy cyklicznej, której rozmiar jest potęgą dwójki.
+ * Indeksy producenta i konsumenta leżą w osobnych liniach pamięci
+ * podręcznej, żeby wątki nie unieważniały sobie nawzajem danych.
+ */
+typedef struct Queue {
+    /** Tablica elementów. */
+    char *items;
+    /** Rozmiar elementu w bajtach. */
+    size_t item_size;
+    /** Liczba miejsc w tablicy. */
+    size_t capacity;
+    /** Liczba zdjętych elementów, zmieniana tylko przez konsumenta. */
+    _Alignas(CACHE_LINE) atomic_size_t head;
+    /** Ostatnio odczytana przez producenta wartość head. */
+    size_t cached_head;
+    /** Liczba wstawionych elementów, zmieniana tylko przez producenta. */
+    _Alignas(CACHE_LINE) atomic_size_t tail;
+    /** Ostatnio odczytana przez konsumenta wartość tail. */
+    size_t cached_tail;
+    /** Liczba wątków uśpionych na zmiennej warunkowej. */
+    _Alignas(CACHE_LINE) atomic_int sleepers;
+    /** Blokada chroniąca usypianie i budzenie wątków. */
+    pthread_mutex_t lock;
+    /** Zmienna warunkowa, na której śpią wątki. */
+    pthread_cond_t wake;
+} Queue;
+
+/**
+ * Funkcja tworzy pustą kolejkę na @p capacity elementów o rozmiarze
+ * @p item_size. Zakładamy, że capacity jest potęgą dwójki.
+ */
+void QueueInit(Queue *q, size_t item_size, size_t capacity);
+
+/**
+ * Funkcja kopiuje element @p item na koniec kolejki. Jeśli kolejka jest
+ * pełna, czeka, aż konsument zdejmie element. Wywołuje ją tylko producent.
+ */
+void QueuePush(Queue *q, const void *item);
+
+/**
+ * Funkcja zdejmuje element z początku kolejki i kopiuje go do @p item.
+ * Jeśli kolejka jest pusta, czeka na producenta. Wywołuje ją tylko konsument.
+ */
+void QueuePop(Queue *q, void *item);
+
+/**
+ * Funkcja zwalnia pamięć kolejki. Elementy pozostałe w kolejce nie są
+ * usuwane.
+ */
+void QueueDestroy(Queue *q);
+
+#endif /* __QUEUE_H__ */
@@ -0,0 +1,124 @@
+/** @file
+  Implementacja rejestrów kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#include "registers.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SIZE 16                     ///< Stała na początkowy rozmiar tablicy.
+#define FNV_OFFSET 14695981039346656037UL   ///< Wartość początkowa skrótu FNV-1a.
+#define FNV_PRIME 1099511628211UL           ///< Mnożnik skrótu FNV-1a.
+
+/**
+ * Liczy skrót FNV-1a nazwy rejestru.
+ */
+static size_t Hash(const char *name, size_t name_length) {
+    unsigned long hash = FNV_OFFSET;
+    for (size_t i = 0; i < name_length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Funkcja zwraca indeks miejsca z rejestrem o podanej nazwie albo, jeśli
+ * takiego nie ma, indeks wolnego miejsca, w którym należałoby go zapisać.
+ * Zakładamy, że tablica nie jest pusta i ma wolne miejsce.
+ */
+static size_t FindSlot(const Registers *r, const char *name, size_t name_length) {
+    size_t mask = r->capacity - 1;
+    size_t i = Hash(name, name_length) & mask;
+    while (r->slots[i].name != NULL &&
+           (r->slots[i].name_length != name_length ||
+            memcmp(r->slots[i].name, name, name_length) != 0)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * Funkcja podwaja rozmiar tablicy i przenosi do niej wszystkie rejestry.
+ */
+static void Grow(Registers *r) {
+    Registers grown = {.size = r->size};
+    grown.capacity = r->capacity == 0 ? INITIAL_SIZE : 2 * r->capacity;
+    grown.slots = calloc(grown.capacity, sizeof(Register));
+    if (grown.slots == NULL) exit(1);
+    for (size_t i = 0; i < r->capacity; i++) {
+        if (r->slots[i].name != NULL) {
+            Register *slot = &r->slots[i];
+            grown.slots[FindSlot(&grown, slot->name, slot->name_length)] = *slot;
+        }
+    }
+    free(r->slots);
+    *r = grown;
+}
+
+void RegistersInit(Registers *r) {
+    *r = (Registers) {.slots = NULL, .size = 0, .capacity = 0};
+}
+
+void RegistersStore(Registers *r, const char *name, size_t name_length, Expr *e) {
+    // Utrzymujemy wypełnienie tablicy poniżej połowy.
+    if (2 * (r->size + 1) > r->capacity) Grow(r);
+    Register *slot = &r->slots[FindSlot(r, name, name_length)];
+    if (slot->name != NULL) {
+        ExprRelease(slot->expr);
+    }
+    else {
+        slot->name = malloc(name_length);
+        if (slot->name == NULL) exit(1);
+        memcpy(slot->name, name, name_length);
+        slot->name_length = name_length;
+        r->size++;
+    }
+    slot->expr = e;
+}
+
+Expr *RegistersFind(const Registers *r, const char *name, size_t name_length) {
+    if (r->size == 0) return NULL;
+    Register *slot = &r->slots[FindSlot(r, name, name_length)];
+    if (slot->name == NULL) return NULL;
+    else return slot->expr;
+}
+
+bool RegistersFree(Registers *r, const char *name, size_t name_length) {
+    if (r->size == 0) return false;
+    size_t mask = r->capacity - 1;
+    size_t i = FindSlot(r, name, name_length);
+    if (r->slots[i].name == NULL) return false;
+    free(r->slots[i].name);
+    ExprRelease(r->slots[i].expr);
+    r->slots[i].name = NULL;
+    r->size--;
+
+    // Przesuwamy w zwolnione miejsce kolejne rejestry z tego samego ciągu
+    // zajętych miejsc, których pozycja docelowa nie leży między dziurą
+    // a nimi, żeby wyszukiwanie nie zatrzymało się na dziurze.
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; r->slots[j].name != NULL; j = (j + 1) & mask) {
+        size_t home = Hash(r->slots[j].name, r->slots[j].name_length) & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            r->slots[hole] = r->slots[j];
+            r->slots[j].name = NULL;
+            hole = j;
+        }
+    }
+    return true;
+}
+
+void RegistersDestroy(Registers *r) {
+    for (size_t i = 0; i < r->capacity; i++) {
+        if (r->slots[i].name != NULL) {
+            free(r->slots[i].name);
+            ExprRelease(r->slots[i].expr);
+        }
+    }
+    free(r->slots);
+    RegistersInit(r);
+}
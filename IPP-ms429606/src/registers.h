@@ -0,0 +1,72 @@
+/** @file
+  Interfejs rejestrów kalkulatora: tablicy haszującej, która przechowuje
+  wielomiany pod nazwami nadanymi przez użytkownika. Rejestr przechowuje
+  referencję do wyrażenia (zob. expr.h), którą współdzieli ze stosem, więc
+  zapisanie i odczytanie rejestru nie kopiuje wielomianu.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __REGISTERS_H__
+#define __REGISTERS_H__
+
+#include "expr.h"
+
+/**
+ * To jest struktura przechowująca jeden rejestr.
+ */
+typedef struct Register {
+    /** Nazwa rejestru (bez znaku zerowego) lub NULL dla wolnego miejsca. */
+    char *name;
+    /** Długość nazwy. */
+    size_t name_length;
+    /** Wyrażenie przechowywane w rejestrze. */
+    Expr *expr;
+} Register;
+
+/**
+ * To jest struktura przechowująca rejestry. Jest to tablica haszująca
+ * z adresowaniem otwartym i liniowym próbkowaniem, której rozmiar jest
+ * potęgą dwójki.
+ */
+typedef struct Registers {
+    /** Tablica miejsc na rejestry. */
+    Register *slots;
+    /** Liczba zajętych miejsc. */
+    size_t size;
+    /** Rozmiar tablicy. */
+    size_t capacity;
+} Registers;
+
+/**
+ * Funkcja inicjuje pusty zbiór rejestrów.
+ */
+void RegistersInit(Registers *r);
+
+/**
+ * Funkcja przejmuje referencję do wyrażenia @p e i zapisuje ją w rejestrze
+ * o nazwie złożonej z @p name_length znaków zaczynających się w @p name.
+ * Referencja do poprzedniej zawartości rejestru jest zwalniana.
+ */
+void RegistersStore(Registers *r, const char *name, size_t name_length, Expr *e);
+
+/**
+ * Funkcja szuka rejestru o podanej nazwie.
+ * @return wyrażenie, do którego referencję ma rejestr, lub NULL, jeśli
+ * rejestru nie ma
+ */
+Expr *RegistersFind(const Registers *r, const char *name, size_t name_length);
+
+/**
+ * Funkcja usuwa rejestr o podanej nazwie i zwalnia jego referencję.
+ * @return false, jeśli takiego rejestru nie było
+ */
+bool RegistersFree(Registers *r, const char *name, size_t name_length);
+
+/**
+ * Funkcja usuwa z pamięci wszystkie rejestry.
+ */
+void RegistersDestroy(Registers *r);
+
+#endif /* __REGISTERS_H__ */
@@ -0,0 +1,206 @@
+/** @file
+  Implementacja trybu serwera kalkulatora i jego klienta.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "server.h"
+#include "session.h"
+#include "input.h"
+#include "output.h"
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SERVER_MIN_THREADS 8            ///< Minimalna liczba wątków serwera.
+#define LISTEN_BACKLOG 64               ///< Długość kolejki oczekujących połączeń.
+#define COPY_BUFFER_SIZE (1 << 16)      ///< Rozmiar bufora przesyłania wejścia.
+#define ERROR_PREFIX "ERROR "           ///< Początek komunikatu o błędzie.
+
+/**
+ * To jest struktura przechowująca dane wspólne dla wątków serwera.
+ */
+typedef struct Server {
+    int listen_fd;              ///< deskryptor gniazda nasłuchującego
+    SessionOptions options;     ///< opcje sesji
+} Server;
+
+/**
+ * Funkcja wypełnia adres gniazda o ścieżce @p path.
+ * @return false, jeśli ścieżka jest za długa
+ */
+static bool SocketAddress(const char *path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) return false;
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+/**
+ * Funkcja tworzy gniazdo nasłuchujące o ścieżce @p path. Pozostawione przez
+ * poprzedni serwer gniazdo o tej ścieżce jest usuwane, ale plik innego
+ * rodzaju nie jest ruszany.
+ * @return deskryptor gniazda lub -1 w razie błędu
+ */
+static int Listen(const char *path) {
+    struct sockaddr_un address;
+    if (!SocketAddress(path, &address)) return -1;
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, LISTEN_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Funkcja wątku serwera. Przyjmuje kolejne połączenia z gniazda
+ * nasłuchującego i obsługuje każde jako osobną sesję, odsyłając wyniki
+ * i komunikaty o błędach tym samym połączeniem.
+ */
+static void *ServerWorker(void *arg) {
+    const Server *server = arg;
+    while (true) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        OutputRedirect(fd, fd);
+        SessionRun(fd, false, &server->options);
+        close(fd);
+    }
+    return NULL;
+}
+
+int ServerRun(const char *path, const SessionOptions *options) {
+    // Zapis do rozłączonego klienta ma kończyć się błędem, a nie sygnałem.
+    signal(SIGPIPE, SIG_IGN);
+    int listen_fd = Listen(path);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Cannot listen on %s\n", path);
+        return 1;
+    }
+
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers < SERVER_MIN_THREADS) workers = SERVER_MIN_THREADS;
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    if (threads == NULL) exit(1);
+    Server server = {.listen_fd = listen_fd, .options = *options};
+    // Procesory zajmują już wątki puli, więc MULMANY nie tworzy nowych.
+    server.options.threads = 1;
+    for (long i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, ServerWorker, &server) != 0) exit(1);
+    }
+    for (long i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    close(listen_fd);
+    return 1;
+}
+
+/**
+ * Funkcja wątku klienta przesyłającego standardowe wejście do serwera.
+ * Po końcu wejścia zamyka połączenie do zapisu, żeby serwer zakończył sesję.
+ */
+static void *SendInput(void *arg) {
+    int fd = *(int *)arg;
+    char *buffer = malloc(COPY_BUFFER_SIZE);
+    if (buffer == NULL) exit(1);
+    bool connected = true;
+    while (connected) {
+        ssize_t count = read(STDIN_FILENO, buffer, COPY_BUFFER_SIZE);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        for (ssize_t sent = 0; sent < count && connected;) {
+            ssize_t written = write(fd, buffer + sent, count - sent);
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0) connected = false;
+            else sent += written;
+        }
+    }
+    shutdown(fd, SHUT_WR);
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * Funkcja przepisuje odpowiedzi serwera w trybie tekstowym, kierując
+ * komunikaty o błędach na standardowe wyjście diagnostyczne. Rozpoznajemy
+ * je po początku linii, bo żaden wypisany wielomian ani liczba nie zaczyna
+ * się od litery.
+ */
+static void SplitLines(Input *in) {
+    const char *line;
+    size_t size;
+    while (true) {
+        if (!InputHasLine(in)) {
+            fflush(stdout);
+            fflush(stderr);
+        }
+        if (!InputNextLine(in, &line, &size)) break;
+        if (size >= strlen(ERROR_PREFIX) &&
+            memcmp(line, ERROR_PREFIX, strlen(ERROR_PREFIX)) == 0) {
+            fwrite(line, 1, size, stderr);
+        }
+        else {
+            fwrite(line, 1, size, stdout);
+        }
+    }
+    fflush(stdout);
+}
+
+/**
+ * Funkcja przepisuje bez zmian odpowiedzi serwera w protokole binarnym.
+ */
+static void CopyFrames(Input *in) {
+    const char *data;
+    size_t size;
+    while (InputNextChunk(in, &data, &size)) {
+        fwrite(data, 1, size, stdout);
+        fflush(stdout);
+    }
+}
+
+int ClientRun(const char *path) {
+    signal(SIGPIPE, SIG_IGN);
+    struct sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !SocketAddress(path, &address) ||
+        connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Cannot connect to %s\n", path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    pthread_t sender;
+    if (pthread_create(&sender, NULL, SendInput, &fd) != 0) exit(1);
+
+    Input in;
+    InputOpen(&in, fd);
+    if (ProtocolDetect(&in)) CopyFrames(&in);
+    else SplitLines(&in);
+    InputClose(&in);
+
+    pthread_join(sender, NULL);
+    close(fd);
+    return 0;
+}
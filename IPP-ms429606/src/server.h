@@ -0,0 +1,42 @@
+/** @file
+  Interfejs trybu serwera kalkulatora i jego klienta. Serwer nasłuchuje
+  na gnieździe domeny uniksowej, a każde połączenie jest osobną sesją
+  z własnym stosem i rejestrami, które żyją do rozłączenia klienta.
+  Klient przesyła polecenia tekstowo, linia po linii, lub ramkami
+  protokołu binarnego (zob. protocol.h), a serwer odsyła
+  wyniki i komunikaty o błędach tym samym połączeniem, w kolejności,
+  w jakiej powstały.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include "session.h"
+
+#define SERVE_OPTION "--serve"      ///< Opcja wiersza poleceń uruchamiająca serwer.
+#define CLIENT_OPTION "--client"    ///< Opcja wiersza poleceń uruchamiająca klienta.
+
+/**
+ * Funkcja uruchamia serwer nasłuchujący na gnieździe o ścieżce @p path.
+ * Sesje obsługuje pula wątków, które na zmianę przyjmują połączenia.
+ * Wyniki zebrane z jednej porcji poleceń są odsyłane, zanim serwer zacznie
+ * czekać na następną. Sesje mają opcje @p options (zob. session.h).
+ * Funkcja wraca tylko w razie błędu.
+ * @return kod wyjścia procesu
+ */
+int ServerRun(const char *path, const SessionOptions *options);
+
+/**
+ * Funkcja uruchamia klienta: łączy się z serwerem na gnieździe o ścieżce
+ * @p path, przesyła mu standardowe wejście, a odpowiedzi wypisuje
+ * na standardowe wyjście, przy czym komunikaty o błędach na standardowe
+ * wyjście diagnostyczne. Odpowiedzi w protokole binarnym są przepisywane
+ * na standardowe wyjście bez zmian.
+ * @return kod wyjścia procesu
+ */
+int ClientRun(const char *path);
+
+#endif /* __SERVER_H__ */
@@ -0,0 +1,150 @@
+/** @file
+  Implementacja sesji kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "session.h"
+#include "poly.h"
+#include "stack.h"
+#include "registers.h"
+#include "program.h"
+#include "input.h"
+#include "output.h"
+#include "queue.h"
+#include "protocol.h"
+#include "stats.h"
+#include "instructions.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+// Stałe liczbowe.
+#define OP_QUEUE_SIZE 1024      ///< Rozmiar kolejki operacji do wątku wykonującego.
+
+/**
+ * Argumenty wątku czytającego.
+ */
+typedef struct Reader {
+    Input *in;                  ///< wejście kalkulatora
+    Queue *ops;                 ///< kolejka operacji do wątku wykonującego
+    StatsScope scope;           ///< statystyki sesji
+} Reader;
+
+/**
+ * Funkcja wątku czytającego. Pobiera po kolei linie z wejścia, kompiluje
+ * je do operacji (zob. program.h) i przekazuje je do wątku wykonującego,
+ * a na końcu operację OP_HALT.
+ */
+static void *ReadLines(void *arg) {
+    Reader *reader = arg;
+    StatsAttach(reader->scope);
+    const char *current_line;
+    size_t line_size;
+    int line_number = 0;
+    Op op;
+    while (true) {
+        // Operacja czekająca na parę nie może czekać na dane z wejścia.
+        if (!InputHasLine(reader->in)) {
+            op = (Op) {.kind = OP_SYNC};
+            QueuePush(reader->ops, &op);
+        }
+        if (!InputNextLine(reader->in, &current_line, &line_size)) break;
+        line_number++;
+        if (CompileLine(current_line, line_size, line_number, &op)) {
+            QueuePush(reader->ops, &op);
+        }
+    }
+    op = (Op) {.kind = OP_HALT};
+    QueuePush(reader->ops, &op);
+    return NULL;
+}
+
+/**
+ * Funkcja przetwarza wejście trzyetapowym potokiem: wątek czytający
+ * wczytuje linie i kompiluje je do operacji, bieżący wątek wykonuje
+ * operacje, a wątek wyjścia formatuje i wypisuje wyniki. Etapy łączą
+ * kolejki SPSC, które zachowują kolejność, więc wyjście jest takie samo
+ * jak przy pracy w jednym wątku.
+ */
+static void RunPipelined(Input *in, Program *program, Stack *Polynomials,
+                         Registers *Memory) {
+    Queue ops;
+    QueueInit(&ops, sizeof(Op), OP_QUEUE_SIZE);
+    OutputStart();
+    Reader reader = {.in = in, .ops = &ops, .scope = StatsCurrent()};
+    pthread_t reader_thread;
+    if (pthread_create(&reader_thread, NULL, ReadLines, &reader) != 0) exit(1);
+
+    Op op;
+    while (true) {
+        QueuePop(&ops, &op);
+        if (op.kind == OP_HALT) break;
+        ProgramFeed(program, &op, Polynomials, Memory);
+    }
+    ProgramFinish(program, Polynomials, Memory);
+
+    pthread_join(reader_thread, NULL);
+    QueueDestroy(&ops);
+}
+
+/**
+ * Funkcja przetwarza wejście w jednym wątku, wykonując te same etapy
+ * co RunPipelined po kolei dla każdej linii. Zanim zacznie czekać na
+ * kolejne dane, wypisuje zebrane wyniki, żeby rozmówca, który czeka na
+ * odpowiedź przed wysłaniem dalszych poleceń, nie czekał w nieskończoność.
+ */
+static void RunSequential(Input *in, Program *program, Stack *Polynomials,
+                          Registers *Memory) {
+    const char *current_line;
+    size_t line_size;
+    int line_number = 0;
+    Op op;
+    while (true) {
+        if (!InputHasLine(in)) {
+            op = (Op) {.kind = OP_SYNC};
+            ProgramFeed(program, &op, Polynomials, Memory);
+            OutputSync();
+        }
+        if (!InputNextLine(in, &current_line, &line_size)) break;
+        line_number++;
+        if (CompileLine(current_line, line_size, line_number, &op)) {
+            ProgramFeed(program, &op, Polynomials, Memory);
+        }
+    }
+    ProgramFinish(program, Polynomials, Memory);
+}
+
+void SessionRun(int fd, bool pipelined, const SessionOptions *options) {
+    Input in;
+    InputOpen(&in, fd);
+    Stack Polynomials;
+    Init(&Polynomials, options->lazy);
+    Registers Memory;
+    RegistersInit(&Memory);
+    Program program;
+    ProgramInit(&program, options->optimize);
+    SetMulThreads(options->threads);
+    Stats stats;
+    bool collect = options->stats || options->stats_on_exit;
+    if (collect) {
+        StatsInit(&stats);
+        StatsAttach((StatsScope) {.stats = &stats, .row = STATS_NO_ROW});
+    }
+
+    if (ProtocolDetect(&in)) ProtocolRun(&in, &program, &Polynomials, &Memory);
+    else if (pipelined) RunPipelined(&in, &program, &Polynomials, &Memory);
+    else RunSequential(&in, &program, &Polynomials, &Memory);
+
+    InputClose(&in);
+    if (options->stats_on_exit) OutputReport(0, StatsFormat(&stats));
+    if (options->optimize) ProgramReport(&program);
+    OutputFlush();
+    StackDestroy(&Polynomials);
+    RegistersDestroy(&Memory);
+    if (collect) {
+        StatsAttach((StatsScope) {.stats = NULL, .row = STATS_NO_ROW});
+        StatsDestroy(&stats);
+    }
+}
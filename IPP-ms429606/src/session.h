@@ -0,0 +1,51 @@
+/** @file
+  Interfejs sesji kalkulatora. Sesja przetwarza całe jedno wejście na
+  własnym stosie i własnych rejestrach, więc kilka sesji może działać
+  jednocześnie w różnych wątkach.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LAZY_OPTION "--lazy"            ///< Opcja wiersza poleceń włączająca leniwe wyliczanie.
+#define OPTIMIZE_OPTION "--optimize"    ///< Opcja wiersza poleceń włączająca łączenie operacji.
+#define STATS_OPTION "--stats"                  ///< Opcja wiersza poleceń włączająca statystyki.
+#define STATS_ON_EXIT_OPTION "--stats-on-exit"  ///< Opcja wiersza poleceń wypisująca statystyki na końcu.
+
+/**
+ * To jest struktura przechowująca opcje sesji.
+ */
+typedef struct SessionOptions {
+    bool lazy;          ///< czy stos jest leniwy (zob. stack.h)
+    bool optimize;      ///< czy operacje są łączone w pary (zob. program.h)
+    bool stats;         ///< czy sesja zbiera statystyki (zob. stats.h)
+    bool stats_on_exit; ///< czy sesja na końcu wypisuje statystyki
+    size_t threads;     ///< największa liczba wątków mnożenia MULMANY
+} SessionOptions;
+
+/**
+ * Funkcja wykonuje wszystkie linie wejścia z deskryptora @p fd na nowym
+ * stosie i nowych rejestrach, wypisując wyniki na wyjście bieżącego wątku
+ * (zob. output.h), po czym wypisuje resztę wyjścia i zwalnia pamięć.
+ * Jeśli @p pipelined jest prawdą, czytanie, wykonywanie i wypisywanie
+ * działają w osobnych wątkach. Wejście zaczynające się nagłówkiem
+ * protokołu binarnego jest przetwarzane w tym protokole (zob. protocol.h).
+ * Z opcją stats albo stats_on_exit sesja zbiera statystyki wykonanych
+ * operacji (zob. stats.h), a z drugą z nich wypisuje je na końcu na swoje
+ * wyjście diagnostyczne. Pomiar czasu każdej operacji jest porównywalny
+ * z wykonaniem prostego polecenia, więc bez tych opcji statystyki nie są
+ * zbierane.
+ * Opcja threads ogranicza liczbę wątków, w których instrukcja MULMANY
+ * liczy iloczyn (zob. SetMulThreads w instructions.h).
+ * Sesja z opcją optimize na końcu wypisuje na swoje wyjście diagnostyczne
+ * liczby połączonych par operacji.
+ */
+void SessionRun(int fd, bool pipelined, const SessionOptions *options);
+
+#endif /* __SESSION_H__ */
@@ -1,5 +1,5 @@
 /** @file
-  Implementacja listowa stosu.
+  Implementacja tablicowa stosu.
 
   @author Mikołaj Szkaradek
   @date 2021
@@ -8,33 +8,145 @@
 #include "poly.h"
 #include "stack.h"
 #include <stdlib.h>
+#include <string.h>
 
-void Init(Stack **s) {
-    *s = NULL;
+#define INITIAL_SIZE 16         ///< Stała na początkowy rozmiar tablicy stosu.
+
+void Init(Stack *s, bool lazy) {
+    *s = (Stack) {.arr = NULL, .exprs = NULL, .size = 0, .capacity = 0, .lazy = lazy};
+}
+
+bool Empty(const Stack *s) {
+    return (s->size == 0);
+}
+
+size_t Depth(const Stack *s) {
+    return s->size;
+}
+
+/**
+ * Funkcja tworzy tablicę wyrażeń stosu, jeśli jeszcze jej nie ma.
+ */
+static void ReserveExprs(Stack *s) {
+    if (s->exprs == NULL) {
+        s->exprs = calloc(s->capacity, sizeof(Expr *));
+        if (s->exprs == NULL) exit(1);
+    }
+}
+
+void Push(Stack *s, Poly p) {
+    if (s->size == s->capacity) {
+        s->capacity = s->capacity == 0 ? INITIAL_SIZE : 2 * s->capacity;
+        s->arr = realloc(s->arr, s->capacity * sizeof(Poly));
+        if (s->arr == NULL) exit(1);
+        if (s->exprs != NULL || s->lazy) {
+            s->exprs = realloc(s->exprs, s->capacity * sizeof(Expr *));
+            if (s->exprs == NULL) exit(1);
+        }
+    }
+    if (s->exprs != NULL) s->exprs[s->size] = NULL;
+    s->arr[s->size++] = p;
+}
+
+Poly Pop(Stack *s) {
+    assert(s->size > 0);
+    Peek(s, 0);
+    return s->arr[--s->size];
+}
+
+void PushExpr(Stack *s, Expr *e) {
+    Push(s, PolyZero());
+    ReserveExprs(s);
+    s->exprs[s->size - 1] = e;
+}
+
+Expr *PopExpr(Stack *s) {
+    Expr *e = TopExpr(s);
+    s->size--;
+    return e;
+}
+
+Expr *TopExpr(Stack *s) {
+    return PeekExpr(s, 0);
+}
+
+Expr *PeekExpr(Stack *s, size_t k) {
+    assert(k < s->size);
+    ReserveExprs(s);
+    size_t i = s->size - 1 - k;
+    if (s->exprs[i] == NULL) {
+        s->exprs[i] = ExprFromPoly(s->arr[i]);
+        s->arr[i] = PolyZero();
+    }
+    return s->exprs[i];
+}
+
+Poly *Top(Stack *s) {
+    return Peek(s, 0);
+}
+
+Poly *Peek(Stack *s, size_t k) {
+    assert(k < s->size);
+    size_t i = s->size - 1 - k;
+    if (s->exprs != NULL && s->exprs[i] != NULL) {
+        // Widok wartości w arr jest tylko pożyczony, więc go nadpisujemy.
+        s->arr[i] = ExprTake(s->exprs[i]);
+        s->exprs[i] = NULL;
+    }
+    return &s->arr[i];
+}
+
+const Poly *PeekValue(Stack *s, size_t k) {
+    assert(k < s->size);
+    size_t i = s->size - 1 - k;
+    if (s->exprs != NULL && s->exprs[i] != NULL) {
+        s->arr[i] = *ExprValue(s->exprs[i]);
+    }
+    return &s->arr[i];
+}
+
+const Poly *Force(Stack *s, size_t count) {
+    assert(0 < count && count <= s->size);
+    for (size_t k = 0; k < count; k++) {
+        PeekValue(s, k);
+    }
+    return &s->arr[s->size - count];
 }
 
-bool Empty(Stack *s) {
-    return (s == NULL);
+void Roll(Stack *s, size_t k) {
+    assert(k < s->size);
+    size_t i = s->size - 1 - k;
+    Poly p = s->arr[i];
+    memmove(&s->arr[i], &s->arr[i + 1], k * sizeof(Poly));
+    s->arr[s->size - 1] = p;
+    if (s->exprs != NULL) {
+        Expr *e = s->exprs[i];
+        memmove(&s->exprs[i], &s->exprs[i + 1], k * sizeof(Expr *));
+        s->exprs[s->size - 1] = e;
+    }
 }
 
-void Push(Stack **s, Poly p) {
-    Stack *temp;
-    temp = malloc(sizeof(Stack));
-    if (temp == NULL) exit(1);
-    temp->next = *s;
-    temp->v = p;
-    *s = temp;
+/**
+ * Funkcja usuwa z pamięci wielomian albo wyrażenie z pozycji @p i stosu.
+ */
+static void DestroyEntry(Stack *s, size_t i) {
+    if (s->exprs != NULL && s->exprs[i] != NULL) ExprRelease(s->exprs[i]);
+    else PolyDestroy(&s->arr[i]);
 }
 
-Poly Pop(Stack **s) {
-    Stack *temp = *s;
-    Poly p;
-    p = (*s)->v;
-    *s = (*s)->next;
-    free(temp);
-    return(p);
+void Discard(Stack *s, size_t count) {
+    assert(count <= s->size);
+    for (size_t i = s->size - count; i < s->size; i++) {
+        DestroyEntry(s, i);
+    }
+    s->size -= count;
 }
 
-Poly Top(Stack *s) {
-    return (s->v);
+void StackDestroy(Stack *s) {
+    for (size_t i = 0; i < s->size; i++) {
+        DestroyEntry(s, i);
+    }
+    free(s->arr);
+    free(s->exprs);
+    Init(s, s->lazy);
 }
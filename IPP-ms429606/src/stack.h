@@ -1,5 +1,5 @@
 /** @file
-  Interfejs listowego stosu.
+  Interfejs tablicowego stosu.
 
   @author Mikołaj Szkaradek
   @date 2021
@@ -8,39 +8,136 @@
 #ifndef __STACK_H__
 #define __STACK_H__
 
+#include "expr.h"
+
 /**
- * To jest struktura przechowująca stos.
+ * To jest struktura przechowująca stos. Wielomiany leżą w jednej ciągłej
+ * tablicy, od dna do wierzchołka, która rośnie geometrycznie, więc wstawianie
+ * i zdejmowanie nie alokują pamięci przy każdej operacji.
+ * Pozycja może zamiast wielomianu przechowywać wyrażenie (zob. expr.h):
+ * na stosie leniwym niewyliczone, a na każdym stosie wielomian współdzielony
+ * z rejestrem. Funkcje zwracające wielomiany wyliczają je w miejscu, więc
+ * reszta kalkulatora widzi zawsze wielomiany. Wielomian współdzielony jest
+ * kopiowany dopiero wtedy, gdy trzeba go zmienić (zob. Peek).
  */
-typedef struct Stack{
-    /** Wielomian. */
-    Poly v;
-    /** Wskaźnik na kolejny element. */
-    struct Stack *next;
-}Stack;
+typedef struct Stack {
+    /** Tablica wielomianów, wierzchołek na pozycji size - 1. */
+    Poly *arr;
+    /**
+     * Tablica wyrażeń równoległa do arr, NULL, dopóki na stos nie trafi
+     * pierwsze wyrażenie. Pozycja różna od NULL oznacza, że wartością
+     * pozycji jest wyrażenie, a arr zawiera na tej pozycji wielomian zerowy
+     * albo pożyczony widok wyliczonej wartości wyrażenia (zob. PeekValue).
+     */
+    Expr **exprs;
+    /** Liczba wielomianów na stosie. */
+    size_t size;
+    /** Rozmiar tablicy. */
+    size_t capacity;
+    /** Czy instrukcje arytmetyczne mają tworzyć wyrażenia. */
+    bool lazy;
+} Stack;
 
 /**
- * Funkcja inicjująca stos.
+ * Funkcja inicjująca stos. Stos jest leniwy, jeżeli @p lazy jest prawdą.
  */
-void Init(Stack **s);
+void Init(Stack *s, bool lazy);
 
 /**
  * Funkcja sprawdza, czy stos jest pusty.
  */
-bool Empty(Stack *s);
+bool Empty(const Stack *s);
+
+/**
+ * Funkcja zwraca liczbę wielomianów na stosie.
+ */
+size_t Depth(const Stack *s);
 
 /**
  * Funkcja wstawia wielomian na wierzchołek stosu.
  */
-void Push(Stack **s, Poly p);
+void Push(Stack *s, Poly p);
 
 /**
  * Funkcja zdejmuje wielomian z wierzchołka stosu.
  */
-Poly Pop(Stack **s);
+Poly Pop(Stack *s);
+
+/**
+ * Funkcja wstawia na wierzchołek stosu wyrażenie, przejmując referencję
+ * wywołującego.
+ */
+void PushExpr(Stack *s, Expr *e);
+
+/**
+ * Funkcja zdejmuje z wierzchołka stosu wyrażenie bez liczenia jego
+ * wartości. Wielomian zamienia na wyrażenie o jego wartości.
+ * @return referencja na własność wywołującego
+ */
+Expr *PopExpr(Stack *s);
+
+/**
+ * Funkcja podgląda wyrażenie na wierzchołku stosu, zamieniając leżący tam
+ * wielomian na wyrażenie.
+ * @return wyrażenie, do którego referencję ma stos
+ */
+Expr *TopExpr(Stack *s);
+
+/**
+ * Funkcja podgląda wyrażenie leżące @p k pozycji pod wierzchołkiem stosu,
+ * zamieniając leżący tam wielomian na wyrażenie. Zakładamy, że
+ * k < Depth(s).
+ * @return wyrażenie, do którego referencję ma stos
+ */
+Expr *PeekExpr(Stack *s, size_t k);
+
+/**
+ * Funkcja podgląda wielomian na wierzchołku stosu. Zwraca wskaźnik do
+ * wielomianu leżącego na stosie, więc można go zmieniać w miejscu.
+ */
+Poly *Top(Stack *s);
+
+/**
+ * Funkcja podgląda wielomian leżący @p k pozycji pod wierzchołkiem stosu
+ * (dla @p k równego 0 jest to wierzchołek), żeby go zmienić w miejscu.
+ * Wyrażenie na tej pozycji zamienia na jego wartość, a wartość
+ * współdzieloną z rejestrem lub inną pozycją najpierw kopiuje.
+ * Zakładamy, że k < Depth(s).
+ */
+Poly *Peek(Stack *s, size_t k);
+
+/**
+ * Funkcja podgląda wielomian leżący @p k pozycji pod wierzchołkiem stosu
+ * tylko do odczytu. Wyrażenie wylicza w miejscu, bez kopiowania wartości,
+ * nawet jeśli jest współdzielone. Wskaźnik jest ważny do następnej zmiany
+ * stosu. Zakładamy, że k < Depth(s).
+ */
+const Poly *PeekValue(Stack *s, size_t k);
+
+/**
+ * Funkcja wylicza wartości @p count wyrażeń z wierzchu stosu, jak
+ * PeekValue, po czym zwraca tablicę ich wartości od leżącej najgłębiej
+ * do wierzchołka. Zakładamy, że 0 < count <= Depth(s).
+ */
+const Poly *Force(Stack *s, size_t count);
+
+/**
+ * Funkcja przenosi wielomian leżący @p k pozycji pod wierzchołkiem stosu
+ * na wierzchołek, przesuwając wielomiany nad nim o jedną pozycję w dół.
+ * Przenoszone są same struktury wielomianów, bez kopiowania jednomianów.
+ * Zakładamy, że k < Depth(s).
+ */
+void Roll(Stack *s, size_t k);
+
+/**
+ * Funkcja zdejmuje @p count wielomianów z wierzchołka stosu i usuwa je
+ * z pamięci. Zakładamy, że count <= Depth(s).
+ */
+void Discard(Stack *s, size_t count);
 
 /**
- * Funkcja podgląda wielomian na wierzchołku stosu.
+ * Funkcja usuwa z pamięci wszystkie wielomiany ze stosu i sam stos.
  */
-Poly Top(Stack *s);
+void StackDestroy(Stack *s);
 
 #endif /* __STACK_H__ */
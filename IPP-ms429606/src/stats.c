@@ -0,0 +1,206 @@
+/** @file
+  Implementacja statystyk sesji kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <time.h>
+
+#define NANOSECONDS 1000000000UL    ///< Liczba nanosekund w sekundzie.
+#define SUB_BUCKETS 4               ///< Liczba przedziałów histogramu na potęgę dwójki.
+#define SUB_BUCKET_BITS 2           ///< Logarytm liczby SUB_BUCKETS.
+#define LONG_BITS 64                ///< Liczba bitów liczby typu unsigned long.
+#define MEDIAN 50                   ///< Percentyl mediany.
+#define TAIL 99                     ///< Percentyl długiego ogona.
+#define PERCENT 100                 ///< Liczba procentów w całości.
+
+/// Zakres, któremu bieżący wątek przypisuje przydziały.
+static _Thread_local StatsScope current = {.stats = NULL, .row = STATS_NO_ROW};
+
+/// Początek mierzonej operacji w bieżącym wątku.
+static _Thread_local unsigned long begin_ns;
+
+/**
+ * Funkcja zwraca bieżący czas monotoniczny w nanosekundach.
+ */
+static unsigned long Now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long)t.tv_sec * NANOSECONDS + (unsigned long)t.tv_nsec;
+}
+
+/**
+ * Funkcja zwraca przedział histogramu dla czasu @p ns. Każda potęga
+ * dwójki jest dzielona na SUB_BUCKETS równych przedziałów.
+ */
+static size_t Bucket(unsigned long ns) {
+    if (ns < SUB_BUCKETS) return ns;
+    int log = LONG_BITS - 1 - __builtin_clzl(ns);
+    unsigned long top = ns >> (log - SUB_BUCKET_BITS);
+    return SUB_BUCKETS * (log - 1) + top - SUB_BUCKETS;
+}
+
+/**
+ * Funkcja zwraca górny kraniec przedziału histogramu @p bucket.
+ */
+static unsigned long BucketEnd(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int log = bucket / SUB_BUCKETS + 1;
+    unsigned long top = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((top + 1) << (log - SUB_BUCKET_BITS)) - 1;
+}
+
+/**
+ * Funkcja podnosi wartość @p peak do @p value, jeśli jest od niej mniejsza.
+ */
+static void RaisePeak(atomic_long *peak, long value) {
+    long old = atomic_load_explicit(peak, memory_order_relaxed);
+    while (old < value &&
+           !atomic_compare_exchange_weak_explicit(peak, &old, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Funkcja liczy w statystykach bieżącego wątku przydział @p bytes bajtów,
+ * w tym @p monos jednomianów, i zmianę liczby zajętych bajtów o @p live.
+ */
+static void Count(unsigned long monos, unsigned long bytes, long live) {
+    Stats *stats = current.stats;
+    atomic_fetch_add_explicit(&stats->monos, monos, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->bytes, bytes, memory_order_relaxed);
+    if (current.row != STATS_NO_ROW) {
+        StatsRow *row = &stats->rows[current.row];
+        atomic_fetch_add_explicit(&row->monos, monos, memory_order_relaxed);
+        atomic_fetch_add_explicit(&row->bytes, bytes, memory_order_relaxed);
+    }
+    long now = atomic_fetch_add_explicit(&stats->live_bytes, live,
+                                         memory_order_relaxed) + live;
+    if (live > 0) {
+        RaisePeak(&stats->peak_live_bytes, now);
+        RaisePeak(&stats->row_peak, now);
+    }
+}
+
+void StatsInit(Stats *stats) {
+    stats->rows = calloc(STATS_ROWS, sizeof(StatsRow));
+    if (stats->rows == NULL) exit(1);
+    atomic_init(&stats->monos, 0);
+    atomic_init(&stats->bytes, 0);
+    atomic_init(&stats->live_bytes, 0);
+    atomic_init(&stats->peak_live_bytes, 0);
+    atomic_init(&stats->row_peak, 0);
+}
+
+void StatsDestroy(Stats *stats) {
+    free(stats->rows);
+}
+
+StatsScope StatsCurrent(void) {
+    return current;
+}
+
+void StatsAttach(StatsScope scope) {
+    current = scope;
+}
+
+void StatsBegin(int row, const char *name) {
+    Stats *stats = current.stats;
+    if (stats == NULL) return;
+    stats->rows[row].name = name;
+    atomic_store_explicit(&stats->row_peak,
+                          atomic_load_explicit(&stats->live_bytes, memory_order_relaxed),
+                          memory_order_relaxed);
+    current.row = row;
+    begin_ns = Now();
+}
+
+void StatsEnd(void) {
+    Stats *stats = current.stats;
+    if (stats == NULL || current.row == STATS_NO_ROW) return;
+    unsigned long ns = Now() - begin_ns;
+    StatsRow *row = &stats->rows[current.row];
+    row->calls++;
+    row->histogram[Bucket(ns)]++;
+    if (ns > row->max_ns) row->max_ns = ns;
+    long peak = atomic_load_explicit(&stats->row_peak, memory_order_relaxed);
+    if (peak > row->peak_live_bytes) row->peak_live_bytes = peak;
+    current.row = STATS_NO_ROW;
+}
+
+Mono *MonosAlloc(size_t count) {
+    Mono *arr = malloc(count * sizeof(Mono));
+    if (current.stats != NULL && arr != NULL) {
+        size_t size = malloc_usable_size(arr);
+        Count(count, size, (long)size);
+    }
+    return arr;
+}
+
+Mono *MonosRealloc(Mono *arr, size_t count) {
+    if (current.stats == NULL) return realloc(arr, count * sizeof(Mono));
+    size_t old_size = malloc_usable_size(arr);
+    Mono *res = realloc(arr, count * sizeof(Mono));
+    if (res != NULL) {
+        size_t size = malloc_usable_size(res);
+        size_t grown = size > old_size ? size - old_size : 0;
+        Count(grown / sizeof(Mono), grown, (long)size - (long)old_size);
+    }
+    return res;
+}
+
+void MonosFree(Mono *arr) {
+    if (current.stats != NULL && arr != NULL) {
+        Count(0, 0, -(long)malloc_usable_size(arr));
+    }
+    free(arr);
+}
+
+/**
+ * Funkcja zwraca percentyl @p percent czasów wykonania operacji.
+ */
+static unsigned long Percentile(const StatsRow *row, unsigned long percent) {
+    // Numer wywołania, które wyznacza percentyl, zaokrąglony w górę.
+    unsigned long rank = (row->calls * percent + PERCENT - 1) / PERCENT;
+    unsigned long seen = 0;
+    for (size_t i = 0; i < STATS_BUCKETS; i++) {
+        seen += row->histogram[i];
+        if (seen >= rank) {
+            unsigned long end = BucketEnd(i);
+            return end < row->max_ns ? end : row->max_ns;
+        }
+    }
+    return row->max_ns;
+}
+
+char *StatsFormat(Stats *stats) {
+    char *text;
+    size_t size;
+    FILE *f = open_memstream(&text, &size);
+    if (f == NULL) exit(1);
+    fprintf(f, "{\"commands\":{");
+    bool first = true;
+    for (size_t i = 0; i < STATS_ROWS; i++) {
+        const StatsRow *row = &stats->rows[i];
+        if (row->calls == 0) continue;
+        fprintf(f, "%s\"%s\":{\"calls\":%lu,\"p50_ns\":%lu,\"p99_ns\":%lu,"
+                "\"max_ns\":%lu,\"monos\":%lu,\"bytes\":%lu,\"peak_live_bytes\":%ld}",
+                first ? "" : ",", row->name, row->calls, Percentile(row, MEDIAN),
+                Percentile(row, TAIL), row->max_ns, atomic_load(&row->monos),
+                atomic_load(&row->bytes), row->peak_live_bytes);
+        first = false;
+    }
+    fprintf(f, "},\"monos\":%lu,\"bytes\":%lu,\"live_bytes\":%ld,"
+            "\"peak_live_bytes\":%ld}", atomic_load(&stats->monos),
+            atomic_load(&stats->bytes), atomic_load(&stats->live_bytes),
+            atomic_load(&stats->peak_live_bytes));
+    if (fclose(f) != 0) exit(1);
+    return text;
+}
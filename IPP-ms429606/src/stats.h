@@ -0,0 +1,116 @@
+/** @file
+  Interfejs statystyk sesji kalkulatora. Dla każdego rodzaju wykonywanych
+  operacji statystyki zbierają liczbę wywołań, histogram czasów wykonania,
+  liczbę przydzielonych jednomianów i bajtów oraz największą liczbę
+  bajtów zajętych przez tablice jednomianów w czasie wykonania.
+  Statystyki są przypisane do wątku, tak jak wyjście (zob. output.h):
+  sesja dołącza swoje statystyki do wątków, które dla niej pracują,
+  a przydziały tablic jednomianów w tych wątkach są liczone w nich.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "poly.h"
+#include <stdatomic.h>
+
+#define STATS_ROWS 64           ///< Największa liczba mierzonych rodzajów operacji.
+#define STATS_BUCKETS 252       ///< Liczba przedziałów histogramu czasów.
+#define STATS_NO_ROW (-1)       ///< Numer rodzaju spoza wykonywanych operacji.
+
+/**
+ * To jest struktura przechowująca statystyki jednego rodzaju operacji.
+ */
+typedef struct StatsRow {
+    const char *name;                       ///< nazwa rodzaju lub NULL
+    unsigned long calls;                    ///< liczba wywołań
+    unsigned long max_ns;                   ///< najdłuższy czas wykonania
+    unsigned long histogram[STATS_BUCKETS]; ///< liczby wywołań w przedziałach czasu
+    atomic_ulong monos;                     ///< liczba przydzielonych jednomianów
+    atomic_ulong bytes;                     ///< liczba przydzielonych bajtów
+    long peak_live_bytes;                   ///< największa liczba zajętych bajtów
+} StatsRow;
+
+/**
+ * To jest struktura przechowująca statystyki sesji.
+ */
+typedef struct Stats {
+    StatsRow *rows;                 ///< statystyki rodzajów operacji
+    atomic_ulong monos;             ///< liczba wszystkich przydzielonych jednomianów
+    atomic_ulong bytes;             ///< liczba wszystkich przydzielonych bajtów
+    atomic_long live_bytes;         ///< liczba zajętych bajtów
+    atomic_long peak_live_bytes;    ///< największa liczba zajętych bajtów
+    atomic_long row_peak;           ///< największa liczba zajętych bajtów w bieżącej operacji
+} Stats;
+
+/**
+ * To jest struktura opisująca, komu bieżący wątek przypisuje przydziały:
+ * statystyki i rodzaj wykonywanej operacji.
+ */
+typedef struct StatsScope {
+    Stats *stats;       ///< statystyki lub NULL, jeśli nie są zbierane
+    int row;            ///< rodzaj operacji lub STATS_NO_ROW
+} StatsScope;
+
+/**
+ * Funkcja tworzy puste statystyki.
+ */
+void StatsInit(Stats *stats);
+
+/**
+ * Funkcja usuwa statystyki z pamięci.
+ */
+void StatsDestroy(Stats *stats);
+
+/**
+ * Funkcja zwraca zakres bieżącego wątku, żeby wątek pomocniczy mógł go
+ * przejąć przez StatsAttach.
+ */
+StatsScope StatsCurrent(void);
+
+/**
+ * Funkcja ustawia zakres bieżącego wątku. Zakres z polem stats równym NULL
+ * wyłącza zbieranie statystyk w wątku.
+ */
+void StatsAttach(StatsScope scope);
+
+/**
+ * Funkcja zaczyna pomiar wykonania operacji rodzaju @p row o nazwie
+ * @p name (stały napis) w statystykach bieżącego wątku.
+ */
+void StatsBegin(int row, const char *name);
+
+/**
+ * Funkcja kończy pomiar zaczęty przez StatsBegin.
+ */
+void StatsEnd(void);
+
+/**
+ * Funkcja przydziela tablicę @p count jednomianów, licząc ją w statystykach
+ * bieżącego wątku. Zwraca NULL, jeśli brakuje pamięci.
+ */
+Mono *MonosAlloc(size_t count);
+
+/**
+ * Funkcja zmienia rozmiar tablicy jednomianów przydzielonej przez MonosAlloc
+ * na @p count jednomianów. Powiększenie tablicy jest liczone jak przydział.
+ */
+Mono *MonosRealloc(Mono *arr, size_t count);
+
+/**
+ * Funkcja zwalnia tablicę jednomianów przydzieloną przez MonosAlloc.
+ */
+void MonosFree(Mono *arr);
+
+/**
+ * Funkcja tworzy jednoliniowy opis statystyk w formacie JSON. Czasy są
+ * w nanosekundach, a percentyle są górnymi krańcami przedziałów histogramu,
+ * o szerokości co najwyżej jednej czwartej ich dolnego krańca.
+ * @return napis do zwolnienia przez wywołującego
+ */
+char *StatsFormat(Stats *stats);
+
+#endif /* __STATS_H__ */
@@ -0,0 +1,127 @@
+/** @file
+  Implementacja śladu wykonania kalkulatora.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+#define _GNU_SOURCE     ///< GNU_SOURCE.
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NANOSECONDS 1000000000L     ///< Liczba nanosekund w sekundzie.
+#define MICROSECOND 1000.0          ///< Liczba nanosekund w mikrosekundzie.
+
+bool trace_enabled = false;
+
+/// Plik śladu lub NULL, jeśli ślad nie jest zapisywany.
+static FILE *trace = NULL;
+
+/// Początek śladu w nanosekundach czasu monotonicznego.
+static long start_ns;
+
+/// Identyfikator procesu w zdarzeniach.
+static int pid;
+
+/// Ostatni nadany identyfikator wątku.
+static atomic_int last_tid;
+
+/// Identyfikator bieżącego wątku w zdarzeniach lub 0, jeśli jeszcze go nie ma.
+static _Thread_local int tid = 0;
+
+/// Liczba otwartych operacji w bieżącym wątku.
+static _Thread_local int op_depth = 0;
+
+/// Liczba otwartych etapów w bieżącym wątku.
+static _Thread_local int phase_depth = 0;
+
+/**
+ * Funkcja zwraca czas od początku śladu w mikrosekundach.
+ */
+static double Timestamp(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec * NANOSECONDS + t.tv_nsec - start_ns) / MICROSECOND;
+}
+
+/**
+ * Funkcja zwraca identyfikator bieżącego wątku, nadając go przy pierwszym
+ * zdarzeniu wątku.
+ */
+static int ThreadId(void) {
+    if (tid == 0) tid = atomic_fetch_add(&last_tid, 1) + 1;
+    return tid;
+}
+
+/**
+ * Funkcja zapisuje początek zdarzenia. Każde zdarzenie jest zapisywane
+ * jednym wywołaniem fprintf, więc zdarzenia różnych wątków się nie mieszają.
+ */
+static void WriteBegin(const char *category, const char *name) {
+    fprintf(trace, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%d}", name, category, Timestamp(), pid, ThreadId());
+}
+
+/**
+ * Funkcja zapisuje koniec ostatniego otwartego zdarzenia wątku.
+ */
+static void WriteEnd(void) {
+    fprintf(trace, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+            Timestamp(), pid, ThreadId());
+}
+
+bool TraceOpen(const char *path) {
+    trace = fopen(path, "w");
+    if (trace == NULL) return false;
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    start_ns = t.tv_sec * NANOSECONDS + t.tv_nsec;
+    pid = (int)getpid();
+    atomic_init(&last_tid, 0);
+    // Pierwszym zdarzeniem jest nazwa procesu, więc każde kolejne zaczyna
+    // się przecinkiem.
+    fprintf(trace, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"args\":{\"name\":\"poly\"}}", pid);
+    trace_enabled = true;
+    return true;
+}
+
+void TraceClose(void) {
+    if (trace == NULL) return;
+    trace_enabled = false;
+    fprintf(trace, "\n]\n");
+    fclose(trace);
+    trace = NULL;
+}
+
+void TraceWriteLineBegin(const char *name, int line_number) {
+    fprintf(trace, ",\n{\"name\":\"%s\",\"cat\":\"line\",\"ph\":\"B\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"line\":%d}}", name, Timestamp(),
+            pid, ThreadId(), line_number);
+}
+
+void TraceWriteLineEnd(void) {
+    WriteEnd();
+}
+
+void TraceWriteBegin(TraceKind kind, const char *name) {
+    if (kind == TRACE_OP) {
+        if (op_depth++ == 0) WriteBegin("poly", name);
+    }
+    else {
+        if (op_depth <= 1 && phase_depth == 0) WriteBegin("phase", name);
+        phase_depth++;
+    }
+}
+
+void TraceWriteEnd(TraceKind kind) {
+    if (kind == TRACE_OP) {
+        if (--op_depth == 0) WriteEnd();
+    }
+    else {
+        if (--phase_depth == 0 && op_depth <= 1) WriteEnd();
+    }
+}
@@ -0,0 +1,95 @@
+/** @file
+  Interfejs śladu wykonania kalkulatora w formacie Chrome trace-event
+  (tablica zdarzeń JSON), który można otworzyć w przeglądarce śladów.
+  Ślad zawiera zdarzenia początku i końca każdej kompilowanej i wykonywanej
+  linii, operacji na wielomianach i ich etapów. Operacje i etapy wywołane
+  rekurencyjnie wewnątrz innych nie są zapisywane, żeby ślad nie rósł
+  z liczbą jednomianów.
+
+  @author Mikołaj Szkaradek
+  @date 2021
+*/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdbool.h>
+
+#define TRACE_OPTION "--trace="     ///< Opcja wiersza poleceń zapisująca ślad do pliku.
+
+/**
+ * Rodzaje zdarzeń śladu wewnątrz linii.
+ */
+typedef enum TraceKind {
+    TRACE_OP,       ///< operacja na wielomianach, zapisywana poza innymi operacjami
+    TRACE_PHASE     ///< etap operacji, zapisywany poza innymi etapami
+} TraceKind;
+
+/**
+ * Funkcja zaczyna zapisywanie śladu do pliku @p path. Wywołujemy ją przed
+ * uruchomieniem wątków kalkulatora.
+ * @return false, jeśli nie udało się utworzyć pliku
+ */
+bool TraceOpen(const char *path);
+
+/**
+ * Funkcja kończy ślad i zamyka jego plik. Wywołujemy ją po zakończeniu
+ * wątków kalkulatora.
+ */
+void TraceClose(void);
+
+/// Czy ślad jest zapisywany. Zmieniają go tylko TraceOpen i TraceClose.
+extern bool trace_enabled;
+
+/**
+ * Funkcja zapisuje w śladzie początek linii (zob. TraceLineBegin).
+ */
+void TraceWriteLineBegin(const char *name, int line_number);
+
+/**
+ * Funkcja zapisuje w śladzie koniec linii (zob. TraceLineEnd).
+ */
+void TraceWriteLineEnd(void);
+
+/**
+ * Funkcja zapisuje w śladzie początek operacji lub etapu (zob. TraceBegin).
+ */
+void TraceWriteBegin(TraceKind kind, const char *name);
+
+/**
+ * Funkcja zapisuje w śladzie koniec operacji lub etapu (zob. TraceEnd).
+ */
+void TraceWriteEnd(TraceKind kind);
+
+/**
+ * Funkcja zapisuje początek linii lub ramki @p line_number wykonywanej przez
+ * polecenie @p name (stały napis). Bez śladu sprawdza tylko trace_enabled,
+ * więc można ją wywoływać dla każdej linii.
+ */
+static inline void TraceLineBegin(const char *name, int line_number) {
+    if (trace_enabled) TraceWriteLineBegin(name, line_number);
+}
+
+/**
+ * Funkcja zapisuje koniec linii zaczętej przez TraceLineBegin.
+ */
+static inline void TraceLineEnd(void) {
+    if (trace_enabled) TraceWriteLineEnd();
+}
+
+/**
+ * Funkcja zapisuje początek operacji lub etapu @p name (stały napis).
+ * Bez śladu nic nie robi.
+ */
+static inline void TraceBegin(TraceKind kind, const char *name) {
+    if (trace_enabled) TraceWriteBegin(kind, name);
+}
+
+/**
+ * Funkcja zapisuje koniec operacji lub etapu zaczętego przez TraceBegin.
+ */
+static inline void TraceEnd(TraceKind kind) {
+    if (trace_enabled) TraceWriteEnd(kind);
+}
+
+#endif /* __TRACE_H__ */